@@ -6,10 +6,30 @@
 #include "keys.h"
 #include "keyboard.h"
 #include "stack.h"
+#include "memory.h"
+#include "save_state.h"
+#include "rewind_buffer.h"
+#include "run_ahead.h"
+#include "headless_display.h"
+#include "movie.h"
 #include "registers.h"
+#include "lazy_flag.h"
+#include "random.h"
 #include "opcodes.h"
 #include "instructions.h"
 #include "instruction_decoder.h"
 #include "instruction_encoder.h"
+#include "quirks.h"
+#include "profiles.h"
 #include "processor.h"
-#include "embedded_language.h"
\ No newline at end of file
+#include "processor_factory.h"
+#include "processor_coroutine.h"
+#include "tiered_executor.h"
+#include "lockstep_validator.h"
+#include "state_hash.h"
+#include "cycle_detector.h"
+#include "input_explorer.h"
+#include "embedded_language.h"
+#include "disassembler.h"
+#include "control_flow.h"
+#include "optimizer.h"
\ No newline at end of file
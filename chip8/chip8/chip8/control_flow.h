@@ -0,0 +1,492 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+#include <algorithm>
+
+#include "base_types.h"
+#include "opcodes.h"
+#include "instructions.h"
+#include "instruction_decoder.h"
+#include "disassembler.h"
+
+namespace chip8
+{
+	enum class region_kind : byte
+	{
+		// Not reached by any path from the entry point, nor read as data
+		unknown,
+
+		code,
+
+		// Drawn as a sprite
+		sprite,
+
+		// Read or written through I other than by drawing
+		data,
+	};
+
+	enum class block_exit : byte
+	{
+		// Falls through into the block that starts at the next instruction
+		fall_through,
+
+		jump,
+		call,
+		skip,
+		function_return,
+		exit,
+
+		// BNNN, whose target depends on V0
+		indirect_jump,
+
+		// Runs into a word that does not decode, or off the end of the image
+		invalid,
+	};
+
+	struct basic_block
+	{
+		pointer start;
+
+		// One past the last byte of the last instruction
+		pointer end;
+
+		block_exit exit;
+
+		// For a call, the first successor is the callee and the second is the return point.
+		// For a skip, the first successor is the next instruction and the second is the one after it.
+		std::uint8_t successor_count;
+		pointer successors[2];
+	};
+
+	// Recovers the basic blocks reachable from the entry point of a program image
+	// by following jumps, calls, skips and fall-through, then classifies every byte
+	// of the image as code, sprite data, other data, or unknown.
+	// Buffers are kept between builds, so once they have grown, analysing a program at load time does not allocate.
+	class control_flow_graph
+	{
+	public:
+		using size_type = std::size_t;
+
+	private:
+		enum flags : byte
+		{
+			reached = (1 << 0),
+			leader = (1 << 1),
+			code_byte = (1 << 2),
+			sprite_byte = (1 << 3),
+			data_byte = (1 << 4),
+			target = (1 << 5),
+		};
+
+	private:
+		const byte * program = nullptr;
+		size_type size = 0;
+		pointer origin = 0x200;
+		instruction_set set = instruction_set::chip8;
+
+		std::vector<byte> address_flags;
+		std::vector<pointer> worklist;
+		std::vector<basic_block> blocks;
+		std::vector<pointer> sprite_addresses;
+
+	public:
+		void build(const byte * program, size_type size, pointer origin = 0x200, instruction_set set = instruction_set::chip8)
+		{
+			this->program = program;
+			this->size = size;
+			this->origin = origin;
+			this->set = set;
+
+			this->address_flags.assign(size, 0);
+			this->worklist.clear();
+			this->blocks.clear();
+			this->sprite_addresses.clear();
+
+			if(size == 0)
+				return;
+
+			this->add_leader(origin, false);
+			this->explore();
+			this->split_blocks();
+
+			std::sort(std::begin(this->sprite_addresses), std::end(this->sprite_addresses));
+			this->sprite_addresses.erase(std::unique(std::begin(this->sprite_addresses), std::end(this->sprite_addresses)), std::end(this->sprite_addresses));
+		}
+
+		// Ordered by start address
+		const std::vector<basic_block> & get_blocks() const
+		{
+			return this->blocks;
+		}
+
+		// Sorted, distinct addresses of sprites drawn through a constant I
+		const std::vector<pointer> & get_sprite_addresses() const
+		{
+			return this->sprite_addresses;
+		}
+
+		const basic_block * find_block(pointer address) const
+		{
+			const auto iterator = std::upper_bound(std::begin(this->blocks), std::end(this->blocks), address, [](pointer value, const basic_block & block)
+			{
+				return (value < block.start);
+			});
+
+			if(iterator == std::begin(this->blocks))
+				return nullptr;
+
+			const basic_block & block = *std::prev(iterator);
+			return (address < block.end) ? &block : nullptr;
+		}
+
+		region_kind get_region(pointer address) const
+		{
+			if(!this->contains(address))
+				return region_kind::unknown;
+
+			const byte value = this->address_flags[address - this->origin];
+
+			if((value & code_byte) != 0)
+				return region_kind::code;
+
+			if((value & sprite_byte) != 0)
+				return region_kind::sprite;
+
+			if((value & data_byte) != 0)
+				return region_kind::data;
+
+			return region_kind::unknown;
+		}
+
+		// Calls visitor(start, end) for each maximal run of bytes that is neither code nor known data,
+		// which is either dead code or data that is only reached through a computed address
+		template< typename Visitor >
+		void visit_unreached(Visitor && visitor) const
+		{
+			const byte known = (code_byte | sprite_byte | data_byte);
+
+			size_type offset = 0;
+			while(offset < this->size)
+			{
+				if((this->address_flags[offset] & known) != 0)
+				{
+					++offset;
+					continue;
+				}
+
+				const size_type start = offset;
+				while(offset < this->size && (this->address_flags[offset] & known) == 0)
+					++offset;
+
+				visitor(static_cast<pointer>(this->origin + start), static_cast<pointer>(this->origin + offset));
+			}
+		}
+
+		// Marks the start of every block entered by a jump or call, and every sprite, for disassembly labelling.
+		// Pass the result through disassembler::keep_line_starts before disassembling with it.
+		void get_labels(label_set & labels) const
+		{
+			labels.assign(0x10000, false);
+
+			for(const auto & block : this->blocks)
+				if((this->address_flags[block.start - this->origin] & target) != 0)
+					labels[block.start] = true;
+
+			for(const pointer address : this->sprite_addresses)
+				labels[address] = true;
+		}
+
+	private:
+		bool contains(size_type address) const
+		{
+			return (address >= this->origin) && ((address - this->origin) < this->size);
+		}
+
+		bool read_word(size_type address, word & value) const
+		{
+			if(!this->contains(address) || !this->contains(address + 1))
+				return false;
+
+			const size_type offset = (address - this->origin);
+			value = static_cast<word>((this->program[offset] << 8) | (this->program[offset + 1] << 0));
+			return true;
+		}
+
+		size_type get_instruction_size(size_type address) const
+		{
+			word value = 0;
+
+			if(this->set == instruction_set::xo_chip && this->read_word(address, value) && value == 0xF000)
+				return 4;
+
+			return 2;
+		}
+
+		void add_leader(size_type address, bool is_target)
+		{
+			if(!this->contains(address))
+				return;
+
+			byte & value = this->address_flags[address - this->origin];
+
+			if(is_target)
+				value |= target;
+
+			if((value & leader) != 0)
+				return;
+
+			value |= leader;
+			this->worklist.push_back(static_cast<pointer>(address));
+		}
+
+		void mark(size_type address, size_type length, flags flag)
+		{
+			for(size_type index = 0; index < length; ++index)
+				if(this->contains(address + index))
+					this->address_flags[address + index - this->origin] |= flag;
+		}
+
+		// Follows each path from a leader until it leaves straight-line code, queuing the leaders it finds
+		void explore()
+		{
+			while(!this->worklist.empty())
+			{
+				size_type address = this->worklist.back();
+				this->worklist.pop_back();
+
+				// The value of I while it is known to hold a constant
+				bool has_constant_i = false;
+				size_type constant_i = 0;
+
+				while(true)
+				{
+					if(!this->contains(address))
+						break;
+
+					// Joining a path explored earlier, which must then start a new block here
+					if((this->address_flags[address - this->origin] & reached) != 0)
+					{
+						this->add_leader(address, false);
+						break;
+					}
+
+					word value = 0;
+					tagged_instruction instruction { opcode_id::clear_screen };
+
+					if(!this->read_word(address, value) || !try_decode(value, this->set, instruction))
+						break;
+
+					const size_type instruction_size = this->get_instruction_size(address);
+					const size_type next = (address + instruction_size);
+
+					this->address_flags[address - this->origin] |= reached;
+					this->mark(address, instruction_size, code_byte);
+
+					const opcode_id opcode = instruction.get_opcode();
+
+					switch(opcode)
+					{
+					case opcode_id::jump_address:
+						this->add_leader(instruction.get_address(), true);
+						break;
+
+					case opcode_id::call_address:
+						this->add_leader(instruction.get_address(), true);
+						this->add_leader(next, false);
+						break;
+
+					case opcode_id::skip_if_equal_register_immediate:
+					case opcode_id::skip_if_not_equal_register_immediate:
+					case opcode_id::skip_if_equal_register_register:
+					case opcode_id::skip_if_not_equal_register_register:
+					case opcode_id::skip_if_key_pressed_register:
+					case opcode_id::skip_if_key_not_pressed_register:
+						this->add_leader(next, false);
+						this->add_leader(next + this->get_instruction_size(next), false);
+						break;
+
+					case opcode_id::load_i_immediate:
+						has_constant_i = true;
+						constant_i = instruction.get_address();
+						break;
+
+					case opcode_id::load_i_long:
+					{
+						word long_address = 0;
+						has_constant_i = this->read_word(address + 2, long_address);
+						constant_i = long_address;
+						break;
+					}
+
+					case opcode_id::draw_x_y_size:
+						if(has_constant_i)
+						{
+							const byte rows = instruction.get_sprite_size();
+							this->mark(constant_i, (rows == 0) ? 32 : rows, sprite_byte);
+							this->sprite_addresses.push_back(static_cast<pointer>(constant_i));
+						}
+						break;
+
+					case opcode_id::load_bcd_register:
+						if(has_constant_i)
+							this->mark(constant_i, 3, data_byte);
+						break;
+
+					case opcode_id::store_registers_i_register:
+					case opcode_id::load_registers_i_register:
+						if(has_constant_i)
+							this->mark(constant_i, to_index(instruction.get_register()) + 1, data_byte);
+						has_constant_i = false;
+						break;
+
+					case opcode_id::store_registers_range:
+					case opcode_id::load_registers_range:
+						if(has_constant_i)
+						{
+							const auto first = to_index(instruction.get_destination_register());
+							const auto last = to_index(instruction.get_source_register());
+							this->mark(constant_i, ((first > last) ? (first - last) : (last - first)) + 1, data_byte);
+						}
+						break;
+
+					case opcode_id::add_i_register:
+					case opcode_id::load_digit_sprite_register:
+					case opcode_id::load_big_digit_sprite_register:
+						has_constant_i = false;
+						break;
+
+					default:
+						break;
+					}
+
+					if(ends_path(opcode))
+						break;
+
+					address = next;
+				}
+			}
+		}
+
+		static bool ends_path(opcode_id opcode)
+		{
+			switch(opcode)
+			{
+			case opcode_id::jump_address:
+			case opcode_id::jump_address_register_0:
+			case opcode_id::function_return:
+			case opcode_id::exit:
+			case opcode_id::call_address:
+			case opcode_id::skip_if_equal_register_immediate:
+			case opcode_id::skip_if_not_equal_register_immediate:
+			case opcode_id::skip_if_equal_register_register:
+			case opcode_id::skip_if_not_equal_register_register:
+			case opcode_id::skip_if_key_pressed_register:
+			case opcode_id::skip_if_key_not_pressed_register:
+				return true;
+			default:
+				return false;
+			}
+		}
+
+		// Cuts the reached instructions into blocks at every leader and every control transfer
+		void split_blocks()
+		{
+			for(size_type offset = 0; offset < this->size; ++offset)
+			{
+				if((this->address_flags[offset] & (leader | reached)) != (leader | reached))
+					continue;
+
+				basic_block block {};
+				block.start = static_cast<pointer>(this->origin + offset);
+				block.exit = block_exit::invalid;
+
+				size_type address = block.start;
+
+				while(true)
+				{
+					word value = 0;
+					tagged_instruction instruction { opcode_id::clear_screen };
+
+					if(!this->read_word(address, value) || !try_decode(value, this->set, instruction))
+					{
+						block.exit = block_exit::invalid;
+						break;
+					}
+
+					const size_type next = (address + this->get_instruction_size(address));
+					address = next;
+
+					if(this->finish_block(block, instruction, next))
+						break;
+
+					// The next instruction starts a block of its own, or was never decoded
+					if(!this->contains(next) || (this->address_flags[next - this->origin] & (leader | reached)) != reached)
+					{
+						const bool is_leader = this->contains(next) && (this->address_flags[next - this->origin] & leader) != 0;
+						block.exit = is_leader ? block_exit::fall_through : block_exit::invalid;
+
+						if(is_leader)
+						{
+							block.successor_count = 1;
+							block.successors[0] = static_cast<pointer>(next);
+						}
+
+						break;
+					}
+				}
+
+				block.end = static_cast<pointer>(address);
+				this->blocks.push_back(block);
+			}
+		}
+
+		// Returns true if the instruction ends its block, filling in how the block exits
+		bool finish_block(basic_block & block, const tagged_instruction & instruction, size_type next) const
+		{
+			switch(instruction.get_opcode())
+			{
+			case opcode_id::jump_address:
+				block.exit = block_exit::jump;
+				block.successor_count = 1;
+				block.successors[0] = instruction.get_address();
+				return true;
+
+			case opcode_id::call_address:
+				block.exit = block_exit::call;
+				block.successor_count = 2;
+				block.successors[0] = instruction.get_address();
+				block.successors[1] = static_cast<pointer>(next);
+				return true;
+
+			case opcode_id::skip_if_equal_register_immediate:
+			case opcode_id::skip_if_not_equal_register_immediate:
+			case opcode_id::skip_if_equal_register_register:
+			case opcode_id::skip_if_not_equal_register_register:
+			case opcode_id::skip_if_key_pressed_register:
+			case opcode_id::skip_if_key_not_pressed_register:
+				block.exit = block_exit::skip;
+				block.successor_count = 2;
+				block.successors[0] = static_cast<pointer>(next);
+				block.successors[1] = static_cast<pointer>(next + this->get_instruction_size(next));
+				return true;
+
+			case opcode_id::function_return:
+				block.exit = block_exit::function_return;
+				return true;
+
+			case opcode_id::exit:
+				block.exit = block_exit::exit;
+				return true;
+
+			case opcode_id::jump_address_register_0:
+				block.exit = block_exit::indirect_jump;
+				return true;
+
+			default:
+				return false;
+			}
+		}
+	};
+}
\ No newline at end of file
@@ -0,0 +1,112 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+
+#include "processor.h"
+
+namespace chip8
+{
+	// Detects that a machine has re-entered a state it was in before, using Brent's algorithm
+	// over the states passed to observe, such as the state at the end of every frame.
+	// Hash matches are confirmed by comparing full save states, so a reported cycle is exact.
+	// The result is only meaningful while the step between observations is deterministic,
+	// which means the input must not change
+	template< typename Processor >
+	class cycle_detector
+	{
+	public:
+		using processor_type = Processor;
+		using state_image_type = typename processor_type::state_image_type;
+		using size_type = std::size_t;
+
+	private:
+		std::unique_ptr<state_image_type> tortoise_state = std::make_unique<state_image_type>();
+		std::unique_ptr<state_image_type> hare_state = std::make_unique<state_image_type>();
+		std::uint64_t tortoise_hash = 0;
+		bool has_tortoise = false;
+
+		std::uint64_t power = 1;
+		std::uint64_t length = 0;
+		std::uint64_t observation_count = 0;
+
+		bool has_cycle_value = false;
+		std::uint64_t cycle_length = 0;
+
+	public:
+		bool has_cycle() const
+		{
+			return this->has_cycle_value;
+		}
+
+		// The number of observations after which the state repeats
+		std::uint64_t get_cycle_length() const
+		{
+			return this->cycle_length;
+		}
+
+		std::uint64_t get_observation_count() const
+		{
+			return this->observation_count;
+		}
+
+		void reset()
+		{
+			this->has_tortoise = false;
+			this->power = 1;
+			this->length = 0;
+			this->observation_count = 0;
+			this->has_cycle_value = false;
+			this->cycle_length = 0;
+		}
+
+		// Returns true once a repeated state has been confirmed
+		bool observe(const processor_type & processor)
+		{
+			if(this->has_cycle_value)
+				return true;
+
+			++this->observation_count;
+
+			const auto hash = processor.get_state_hash();
+
+			if(!this->has_tortoise)
+			{
+				this->move_tortoise(processor, hash);
+				return false;
+			}
+
+			++this->length;
+
+			if(hash == this->tortoise_hash)
+			{
+				processor.save_state(*this->hare_state);
+
+				if(this->tortoise_state->has_same_machine_state(*this->hare_state))
+				{
+					this->has_cycle_value = true;
+					this->cycle_length = this->length;
+					return true;
+				}
+			}
+
+			if(this->length == this->power)
+			{
+				this->move_tortoise(processor, hash);
+				this->power *= 2;
+			}
+
+			return false;
+		}
+
+	private:
+		void move_tortoise(const processor_type & processor, std::uint64_t hash)
+		{
+			processor.save_state(*this->tortoise_state);
+			this->tortoise_hash = hash;
+			this->has_tortoise = true;
+			this->length = 0;
+		}
+	};
+}
\ No newline at end of file
@@ -0,0 +1,428 @@
+#pragma once
+
+#include <cstddef>
+#include <cstring>
+#include <vector>
+#include <stdexcept>
+
+#include "base_types.h"
+#include "opcodes.h"
+#include "registers.h"
+#include "instructions.h"
+#include "instruction_decoder.h"
+
+namespace chip8
+{
+	// One flag per address of a 64K address space
+	using label_set = std::vector<bool>;
+
+	struct disassembly_options
+	{
+		pointer origin = 0x200;
+
+		// Prefixes each line with its address and raw words
+		bool listing = false;
+
+		// Addresses to emit labels for, which must each begin a line, as with the result of find_labels
+		const label_set * labels = nullptr;
+	};
+
+	namespace disassembly_helpers
+	{
+		constexpr char hex_digits[] = "0123456789ABCDEF";
+
+		inline char * write_text(char * output, const char * text)
+		{
+			while(*text != '\0')
+			{
+				*output = *text;
+				++output;
+				++text;
+			}
+
+			return output;
+		}
+
+		inline char * write_hex(char * output, unsigned value, unsigned digits)
+		{
+			for(unsigned shift = (digits * 4); shift > 0; shift -= 4)
+			{
+				*output = hex_digits[(value >> (shift - 4)) & 0x0F];
+				++output;
+			}
+
+			return output;
+		}
+
+		inline char * write_number(char * output, unsigned value, unsigned digits)
+		{
+			output[0] = '0';
+			output[1] = 'x';
+			return write_hex(output + 2, value, digits);
+		}
+
+		inline char * write_decimal(char * output, unsigned value)
+		{
+			if(value >= 10)
+				output = write_decimal(output, value / 10);
+
+			*output = static_cast<char>('0' + (value % 10));
+			return (output + 1);
+		}
+
+		inline char * write_register(char * output, register_id id)
+		{
+			output[0] = 'v';
+			output[1] = "0123456789abcdef"[to_index(id) & 0x0F];
+			return (output + 2);
+		}
+
+		inline char * write_label(char * output, unsigned address)
+		{
+			*output = 'L';
+			return write_hex(output + 1, address, 4);
+		}
+
+		inline word read_word(const byte * program)
+		{
+			return static_cast<word>((program[0] << 8) | (program[1] << 0));
+		}
+	}
+
+	// Every word is formatted once up front into a table shared by all later calls,
+	// so disassembling is little more than copying table entries into the output
+	class disassembler
+	{
+	public:
+		using size_type = std::size_t;
+
+	public:
+		static constexpr size_type max_text_length = 14;
+
+		// An upper bound on the output produced for each two bytes of input
+		static constexpr size_type max_output_per_word = 48;
+
+	private:
+		enum class entry_kind : byte
+		{
+			// The text is the whole instruction
+			complete,
+
+			// The text is followed by the address from the low 12 bits
+			address,
+
+			// The text is followed by the address held in the next word
+			long_address,
+
+			// The word is not an instruction
+			data,
+		};
+
+		struct table_entry
+		{
+			char text[max_text_length];
+			byte length;
+			entry_kind kind;
+		};
+
+		static_assert(sizeof(table_entry) == 16, "table entries should stay small enough to pack four to a cache line");
+
+	private:
+		instruction_set set;
+		std::vector<table_entry> table;
+
+	public:
+		explicit disassembler(instruction_set set = instruction_set::chip8) :
+			set(set), table(0x10000)
+		{
+			for(std::size_t value = 0; value < this->table.size(); ++value)
+				this->table[value] = create_entry(static_cast<word>(value), set);
+		}
+
+		instruction_set get_instruction_set() const
+		{
+			return this->set;
+		}
+
+		static constexpr size_type get_output_capacity(size_type program_size)
+		{
+			return (((program_size + 1) / 2) * max_output_per_word);
+		}
+
+		// Marks the targets of jumps, calls and I register loads that begin an instruction
+		void find_labels(const byte * program, size_type size, pointer origin, label_set & labels) const
+		{
+			labels.assign(0x10000, false);
+
+			this->sweep(program, size, [&](size_type, entry_kind kind, word value, word long_value)
+			{
+				if(kind == entry_kind::address)
+					labels[value & 0x0FFF] = true;
+				else if(kind == entry_kind::long_address)
+					labels[long_value] = true;
+			});
+
+			this->keep_line_starts(program, size, origin, labels);
+		}
+
+		// Drops labels that fall inside an instruction as this disassembler splits the program,
+		// such as labels found by a separate control-flow pass
+		void keep_line_starts(const byte * program, size_type size, pointer origin, label_set & labels) const
+		{
+			label_set line_starts(0x10000, false);
+
+			this->sweep(program, size, [&](size_type offset, entry_kind, word, word)
+			{
+				line_starts[(origin + offset) & 0xFFFF] = true;
+			});
+
+			for(std::size_t address = 0; address < labels.size(); ++address)
+				labels[address] = (labels[address] && line_starts[address]);
+		}
+
+		// The output must hold at least get_output_capacity(size) characters.
+		// Returns the number of characters written, which are not null terminated.
+		size_type disassemble(const byte * program, size_type size, char * output, const disassembly_options & options = disassembly_options()) const
+		{
+			using namespace disassembly_helpers;
+
+			char * current = output;
+
+			this->sweep(program, size, [&](size_type offset, entry_kind kind, word value, word long_value)
+			{
+				const unsigned address = ((options.origin + offset) & 0xFFFF);
+
+				if(options.labels != nullptr && (*options.labels)[address])
+				{
+					current = write_label(current, address);
+					current = write_text(current, ":\n");
+				}
+
+				const bool is_partial = ((offset + 1) == size);
+				const bool is_long = (kind == entry_kind::long_address);
+
+				if(options.listing)
+				{
+					current = write_hex(current, address, 4);
+					current = write_text(current, "  ");
+
+					if(is_partial)
+						current = write_text(write_hex(current, program[offset], 2), "  ");
+					else
+						current = write_hex(current, value, 4);
+
+					if(is_long)
+					{
+						*current = ' ';
+						current = write_hex(current + 1, long_value, 4);
+					}
+
+					current = write_text(current, "  ");
+				}
+				else
+				{
+					*current = '\t';
+					++current;
+				}
+
+				if(is_partial)
+				{
+					current = write_number(write_text(current, "db "), program[offset], 2);
+				}
+				else if(kind != this->table[value].kind)
+				{
+					// A long load too close to the end to hold its address
+					current = write_number(write_text(current, "db "), (value >> 8) & 0xFF, 2);
+					current = write_number(write_text(current, ", "), (value >> 0) & 0xFF, 2);
+				}
+				else
+				{
+					const table_entry & entry = this->table[value];
+
+					// Entries are fixed size, so copying the whole of one is cheaper than copying its exact length
+					std::memcpy(current, entry.text, max_text_length);
+					current += entry.length;
+
+					if(kind == entry_kind::address)
+						current = this->write_address(current, value & 0x0FFF, options);
+					else if(is_long)
+						current = this->write_address(current, long_value, options);
+				}
+
+				*current = '\n';
+				++current;
+			});
+
+			return static_cast<size_type>(current - output);
+		}
+
+	private:
+		// Visits each instruction or data item in address order, with a single linear pass
+		template< typename Visitor >
+		void sweep(const byte * program, size_type size, Visitor && visitor) const
+		{
+			size_type offset = 0;
+
+			while((offset + 1) < size)
+			{
+				const word value = disassembly_helpers::read_word(program + offset);
+				const entry_kind kind = this->table[value].kind;
+
+				if(kind == entry_kind::long_address)
+				{
+					// Too close to the end to hold its address
+					if((offset + 3) >= size)
+					{
+						visitor(offset, entry_kind::data, value, 0);
+						offset += 2;
+						continue;
+					}
+
+					visitor(offset, kind, value, disassembly_helpers::read_word(program + offset + 2));
+					offset += 4;
+					continue;
+				}
+
+				visitor(offset, kind, value, 0);
+				offset += 2;
+			}
+
+			// A trailing odd byte
+			if(offset < size)
+				visitor(offset, entry_kind::data, 0, 0);
+		}
+
+		char * write_address(char * output, unsigned address, const disassembly_options & options) const
+		{
+			using namespace disassembly_helpers;
+
+			if(options.labels != nullptr && (*options.labels)[address])
+				return write_label(output, address);
+
+			return write_number(output, address, (address > 0xFFF) ? 4 : 3);
+		}
+
+		static table_entry create_data_entry(word value)
+		{
+			using namespace disassembly_helpers;
+
+			table_entry entry {};
+			char * output = entry.text;
+			entry.kind = entry_kind::data;
+
+			output = write_number(write_text(output, "db "), (value >> 8) & 0xFF, 2);
+			output = write_number(write_text(output, ", "), (value >> 0) & 0xFF, 2);
+
+			entry.length = static_cast<byte>(output - entry.text);
+			return entry;
+		}
+
+		static table_entry create_entry(word value, instruction_set set)
+		{
+			using namespace disassembly_helpers;
+
+			table_entry entry {};
+			char * output = entry.text;
+			entry.kind = entry_kind::complete;
+
+			tagged_instruction instruction { opcode_id::clear_screen };
+
+			if(!try_decode(value, set, instruction))
+				return create_data_entry(value);
+
+			const register_id x = decode_helpers::get_x_register(value);
+			const register_id y = decode_helpers::get_y_register(value);
+			const byte immediate = decode_helpers::get_immediate(value);
+			const byte nibble = decode_helpers::get_function_type(value);
+
+			const auto write_x_y = [&](const char * mnemonic)
+			{
+				output = write_text(output, mnemonic);
+				output = write_register(output, x);
+				output = write_text(output, ", ");
+				output = write_register(output, y);
+			};
+
+			const auto write_x_immediate = [&](const char * mnemonic)
+			{
+				output = write_text(output, mnemonic);
+				output = write_register(output, x);
+				output = write_text(output, ", ");
+				output = write_number(output, immediate, 2);
+			};
+
+			const auto write_x = [&](const char * mnemonic, const char * suffix)
+			{
+				output = write_text(output, mnemonic);
+				output = write_register(output, x);
+				output = write_text(output, suffix);
+			};
+
+			switch(instruction.get_opcode())
+			{
+			case opcode_id::clear_screen: output = write_text(output, "cls"); break;
+			case opcode_id::function_return: output = write_text(output, "ret"); break;
+			case opcode_id::exit: output = write_text(output, "exit"); break;
+			case opcode_id::scroll_right: output = write_text(output, "scr"); break;
+			case opcode_id::scroll_left: output = write_text(output, "scl"); break;
+			case opcode_id::low_resolution: output = write_text(output, "low"); break;
+			case opcode_id::high_resolution: output = write_text(output, "high"); break;
+			case opcode_id::scroll_down_immediate: output = write_decimal(write_text(output, "scd "), nibble); break;
+			case opcode_id::scroll_up_immediate: output = write_decimal(write_text(output, "scu "), nibble); break;
+			case opcode_id::select_planes_immediate: output = write_decimal(write_text(output, "plane "), static_cast<unsigned>(to_index(x))); break;
+
+			case opcode_id::jump_address: entry.kind = entry_kind::address; output = write_text(output, "jp "); break;
+			case opcode_id::call_address: entry.kind = entry_kind::address; output = write_text(output, "call "); break;
+			case opcode_id::load_i_immediate: entry.kind = entry_kind::address; output = write_text(output, "ld i, "); break;
+			case opcode_id::jump_address_register_0: entry.kind = entry_kind::address; output = write_text(output, "jp v0, "); break;
+			case opcode_id::load_i_long: entry.kind = entry_kind::long_address; output = write_text(output, "ld i, long "); break;
+
+			case opcode_id::skip_if_equal_register_immediate: write_x_immediate("se "); break;
+			case opcode_id::skip_if_not_equal_register_immediate: write_x_immediate("sne "); break;
+			case opcode_id::load_register_immediate: write_x_immediate("ld "); break;
+			case opcode_id::add_register_immediate: write_x_immediate("add "); break;
+			case opcode_id::random_register_immediate: write_x_immediate("rnd "); break;
+
+			case opcode_id::skip_if_equal_register_register: write_x_y("se "); break;
+			case opcode_id::skip_if_not_equal_register_register: write_x_y("sne "); break;
+			case opcode_id::load_register_register: write_x_y("ld "); break;
+			case opcode_id::or_register_register: write_x_y("or "); break;
+			case opcode_id::and_register_register: write_x_y("and "); break;
+			case opcode_id::xor_register_register: write_x_y("xor "); break;
+			case opcode_id::add_register_register: write_x_y("add "); break;
+			case opcode_id::subtract_register_register: write_x_y("sub "); break;
+			case opcode_id::shift_right_register_register: write_x_y("shr "); break;
+			case opcode_id::reverse_subtract_register_register: write_x_y("subn "); break;
+			case opcode_id::shift_left_register_register: write_x_y("shl "); break;
+			case opcode_id::store_registers_range: write_x_y("save "); break;
+			case opcode_id::load_registers_range: write_x_y("load "); break;
+
+			case opcode_id::draw_x_y_size:
+				write_x_y("drw ");
+				output = write_decimal(write_text(output, ", "), nibble);
+				break;
+
+			case opcode_id::skip_if_key_pressed_register: write_x("skp ", ""); break;
+			case opcode_id::skip_if_key_not_pressed_register: write_x("sknp ", ""); break;
+			case opcode_id::read_delay_timer_register: write_x("ld ", ", dt"); break;
+			case opcode_id::await_key_press_register: write_x("ld ", ", k"); break;
+			case opcode_id::load_registers_i_register: write_x("ld ", ", [i]"); break;
+			case opcode_id::load_flags_register: write_x("ld ", ", r"); break;
+			case opcode_id::write_delay_timer_register: write_x("ld dt, ", ""); break;
+			case opcode_id::write_sound_timer_register: write_x("ld st, ", ""); break;
+			case opcode_id::add_i_register: write_x("add i, ", ""); break;
+			case opcode_id::load_digit_sprite_register: write_x("ld f, ", ""); break;
+			case opcode_id::load_big_digit_sprite_register: write_x("ld hf, ", ""); break;
+			case opcode_id::load_bcd_register: write_x("ld b, ", ""); break;
+			case opcode_id::store_registers_i_register: write_x("ld [i], ", ""); break;
+			case opcode_id::store_flags_register: write_x("ld r, ", ""); break;
+
+			default:
+				throw std::logic_error("disassembler has no format for a decodable opcode");
+			}
+
+			entry.length = static_cast<byte>(output - entry.text);
+			return entry;
+		}
+	};
+}
\ No newline at end of file
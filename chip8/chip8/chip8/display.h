@@ -4,14 +4,17 @@
 
 namespace chip8
 {
-	struct display
+	template< typename DisplayBuffer >
+	struct basic_display
 	{
-		using display_buffer = chip8::display_buffer<64, 32>;
+		using display_buffer = DisplayBuffer;
 
-		virtual ~display() = default;
+		virtual ~basic_display() = default;
 
 		virtual void update(const display_buffer & buffer) = 0;
 
 		virtual void render() = 0;
 	};
+
+	using display = basic_display<display_buffer<64, 32>>;
 }
\ No newline at end of file
@@ -2,33 +2,110 @@
 
 #include <cstddef>
 #include <cstdint>
-#include <bitset>
+#include <array>
+#include <iterator>
+#include <algorithm>
+
+#include "state_hash.h"
 
 namespace chip8
 {
-	template< std::size_t width_value, std::size_t height_value >
+	template< std::size_t width_value, std::size_t height_value, std::size_t plane_count_value = 1 >
 	class display_buffer
 	{
 	public:
 		using size_type = std::size_t;
+		using value_type = std::uint8_t;
 
-	private:
+	public:
 		static constexpr size_type width = width_value;
 		static constexpr size_type height = height_value;
 		static constexpr size_type pixel_count = (width * height);
 
+		static constexpr size_type row_size = (width / 8);
+		static constexpr size_type plane_count = plane_count_value;
+		static constexpr size_type plane_size = (row_size * height);
+		static constexpr size_type byte_count = (plane_size * plane_count);
+
+		static_assert((width % 8) == 0, "display width must be a multiple of 8");
+		static_assert((plane_count > 0) && (plane_count <= 8), "display must have between 1 and 8 planes");
+
 	private:
-		using buffer_type = std::bitset<pixel_count>;
+		using buffer_type = std::array<value_type, byte_count>;
 
 	public:
-		using reference = typename buffer_type::reference;
+		class reference
+		{
+		private:
+			value_type * data;
+			value_type mask;
+			std::uint64_t * hash;
+			size_type index;
+
+		public:
+			reference(value_type & data, value_type mask, std::uint64_t & hash, size_type index) :
+				data(&data), mask(mask), hash(&hash), index(index)
+			{
+			}
+
+			reference(const reference & other) = default;
+
+			reference & operator =(bool value)
+			{
+				const value_type old_value = *this->data;
+
+				if(value)
+					*this->data |= this->mask;
+				else
+					*this->data &= static_cast<value_type>(~this->mask);
+
+				*this->hash = state_hash_helpers::update(*this->hash, state_hash_helpers::display_salt, this->index, old_value, *this->data);
+				return *this;
+			}
+
+			reference & operator =(const reference & other)
+			{
+				return (*this = static_cast<bool>(other));
+			}
+
+			operator bool() const
+			{
+				return ((*this->data & this->mask) != 0);
+			}
+
+			bool operator ~() const
+			{
+				return !static_cast<bool>(*this);
+			}
+
+			reference & flip()
+			{
+				const value_type old_value = *this->data;
+
+				*this->data ^= this->mask;
+
+				*this->hash = state_hash_helpers::update(*this->hash, state_hash_helpers::display_salt, this->index, old_value, *this->data);
+				return *this;
+			}
+		};
 
 	private:
-		buffer_type buffer;
+		buffer_type buffer {};
+		std::uint64_t hash = 0;
 
 		static constexpr size_type flatten(size_type x, size_type y)
 		{
-			return ((y * width) + x);
+			return ((y * row_size) + (x / 8));
+		}
+
+		static constexpr size_type flatten(size_type plane, size_type x, size_type y)
+		{
+			return ((plane * plane_size) + flatten(x, y));
+		}
+
+		static constexpr value_type get_mask(size_type x)
+		{
+			return static_cast<value_type>(0x80 >> (x % 8));
 		}
 
 	public:
@@ -42,27 +119,87 @@ namespace chip8
 			return height;
 		}
 
+		constexpr size_type get_plane_count() const
+		{
+			return plane_count;
+		}
+
 		void clear()
 		{
-			this->buffer.reset();
+			this->buffer.fill(0);
+			this->hash = 0;
+		}
+
+		void clear_plane(size_type plane)
+		{
+			const auto begin = std::next(std::begin(this->buffer), plane * plane_size);
+			std::fill(begin, std::next(begin, plane_size), 0);
+			this->rehash();
+		}
+
+		// Maintained on every pixel write rather than computed on demand
+		std::uint64_t get_hash() const
+		{
+			return this->hash;
+		}
+
+		// Must be called after writing through data()
+		void rehash()
+		{
+			this->hash = state_hash_helpers::hash_range(state_hash_helpers::display_salt, 0, this->buffer.data(), this->buffer.data() + byte_count);
+		}
+
+		void assign(const value_type * data)
+		{
+			std::copy_n(data, byte_count, std::begin(this->buffer));
+			this->rehash();
+		}
+
+		// Pixels are packed eight to a byte, row by row,
+		// with the leftmost pixel in the most significant bit.
+		// Each plane follows the previous one
+		value_type * data()
+		{
+			return this->buffer.data();
+		}
+
+		const value_type * data() const
+		{
+			return this->buffer.data();
+		}
+
+		constexpr size_type size() const
+		{
+			return byte_count;
 		}
 
 		bool test(size_type x, size_type y) const
 		{
-			const size_type index = flatten(x, y);
-			return this->buffer.test(index);
+			return this->at(x, y);
 		}
 
 		bool at(size_type x, size_type y) const
 		{
 			const size_type index = flatten(x, y);
-			return this->buffer[index];
+			return ((this->buffer[index] & get_mask(x)) != 0);
 		}
 
 		reference at(size_type x, size_type y)
 		{
 			const size_type index = flatten(x, y);
-			return this->buffer[index];
+			return reference(this->buffer[index], get_mask(x), this->hash, index);
+		}
+
+		bool at(size_type plane, size_type x, size_type y) const
+		{
+			const size_type index = flatten(plane, x, y);
+			return ((this->buffer[index] & get_mask(x)) != 0);
+		}
+
+		reference at(size_type plane, size_type x, size_type y)
+		{
+			const size_type index = flatten(plane, x, y);
+			return reference(this->buffer[index], get_mask(x), this->hash, index);
 		}
 
 		bool wrap_at(size_type x, size_type y) const
@@ -74,5 +211,79 @@ namespace chip8
 		{
 			return this->at(x % this->get_width(), y % this->get_height());
 		}
+
+		reference wrap_at(size_type plane, size_type x, size_type y)
+		{
+			return this->at(plane, x % this->get_width(), y % this->get_height());
+		}
+
+		// Combines the bit from each plane into a colour index,
+		// with plane 0 in the least significant bit
+		value_type get_pixel(size_type x, size_type y) const
+		{
+			value_type result = 0;
+
+			for(size_type plane = 0; plane < plane_count; ++plane)
+				if(this->at(plane, x, y))
+					result |= static_cast<value_type>(1u << plane);
+
+			return result;
+		}
+
+		void scroll_down(size_type plane, size_type amount)
+		{
+			const auto plane_begin = std::next(std::begin(this->buffer), plane * plane_size);
+			const auto plane_end = std::next(plane_begin, plane_size);
+
+			if(amount >= height)
+			{
+				this->clear_plane(plane);
+				return;
+			}
+
+			std::copy_backward(plane_begin, std::prev(plane_end, amount * row_size), plane_end);
+			std::fill(plane_begin, std::next(plane_begin, amount * row_size), 0);
+			this->rehash();
+		}
+
+		void scroll_up(size_type plane, size_type amount)
+		{
+			const auto plane_begin = std::next(std::begin(this->buffer), plane * plane_size);
+			const auto plane_end = std::next(plane_begin, plane_size);
+
+			if(amount >= height)
+			{
+				this->clear_plane(plane);
+				return;
+			}
+
+			std::copy(std::next(plane_begin, amount * row_size), plane_end, plane_begin);
+			std::fill(std::prev(plane_end, amount * row_size), plane_end, 0);
+			this->rehash();
+		}
+
+		void scroll_right(size_type plane, size_type amount)
+		{
+			for(size_type y = 0; y < height; ++y)
+				for(size_type x = width; x > 0; --x)
+					this->at(plane, x - 1, y) = ((x - 1) >= amount) && this->at(plane, x - 1 - amount, y);
+		}
+
+		void scroll_left(size_type plane, size_type amount)
+		{
+			for(size_type y = 0; y < height; ++y)
+				for(size_type x = 0; x < width; ++x)
+					this->at(plane, x, y) = ((x + amount) < width) && this->at(plane, x + amount, y);
+		}
+
+		bool operator ==(const display_buffer & other) const
+		{
+			return (this->buffer == other.buffer);
+		}
+
+		bool operator !=(const display_buffer & other) const
+		{
+			return (this->buffer != other.buffer);
+		}
 	};
 }
\ No newline at end of file
@@ -1,6 +1,14 @@
 #pragma once
 
+#include <cstddef>
+#include <array>
+#include <utility>
+#include <stdexcept>
+#include <vector>
+#include <algorithm>
+
 #include "instruction_encoder.h"
+#include "optimizer.h"
 
 //
 // VOODOO!!!
@@ -12,17 +20,172 @@ namespace chip8
 {
 	namespace lang
 	{
+		enum class optimization : byte
+		{
+			none,
+
+			// Runs the program through a peephole_optimizer once it ends
+			peephole,
+		};
+
+		struct label
+		{
+		public:
+			using index_type = std::size_t;
+
+		public:
+			// Links are held in the 12 bits of a jump's address
+			static constexpr index_type max_forward_reference_link = 0x0FFF;
+
+		private:
+			bool was_set = false;
+			index_type index = 0;
+
+			// Jumps written before this label was placed form a chain through their own address fields,
+			// each linking to the one written before it, so any number can be held without storage.
+			// A link is the offset just past a jump, so 0 ends the chain
+			index_type forward_reference_link = 0;
+
+			constexpr void set()
+			{
+				this->was_set = true;
+			}
+
+		public:
+			constexpr label() = default;
+
+			constexpr bool is_set() const
+			{
+				return this->was_set;
+			}
+
+			constexpr index_type get_address() const
+			{
+				return this->index;
+			}
+
+			constexpr void set(index_type index)
+			{
+				if(this->is_set())
+					throw std::logic_error("attempt to reassign a label");
+
+				this->index = index;
+				this->set();
+			}
+
+			// Returns the link the jump at offset must hold until the label is placed
+			constexpr index_type add_forward_reference(index_type offset)
+			{
+				if((offset + sizeof(word)) > max_forward_reference_link)
+					throw std::length_error("jump to a label before it is placed is too far into the program");
+
+				const index_type previous = this->forward_reference_link;
+				this->forward_reference_link = (offset + sizeof(word));
+				return previous;
+			}
+
+			// The most recent jump written before the label was placed, or 0 if there are none
+			constexpr index_type get_forward_reference_link() const
+			{
+				return this->forward_reference_link;
+			}
+
+			static constexpr index_type get_forward_reference_offset(index_type link)
+			{
+				return (link - sizeof(word));
+			}
+		};
+
+		enum class block_kind : byte
+		{
+			if_block,
+			else_block,
+			while_block,
+			for_block,
+		};
+
+		struct control_block
+		{
+			block_kind kind;
+
+			// The head of a loop
+			label start;
+
+			// Where control goes when the condition does not hold
+			label exit;
+
+			// The end of an if block that has an else
+			label end;
+
+			// Where the body begins, and the skip that would run it with a single skip when it is one instruction long
+			std::size_t body_start;
+			word inverse_skip;
+
+			// Changes when a label inside the block is placed or referred to,
+			// as the body may then only be moved if nothing refers to it
+			std::size_t label_events;
+
+			// The step of a for block, written at the end of every pass
+			std::vector<byte> step;
+		};
+
+		enum class inlining : byte
+		{
+			// Only bodies no larger than the call that replaces them
+			size,
+
+			// Also short bodies, and longer ones called from inside a loop
+			balanced,
+
+			// Every body that fits, so that no call or return runs
+			speed,
+		};
+
 		struct program
 		{
 		public:
-			using encoder_type = chip8::encoder;
+			using encoder_type = chip8::basic_encoder<vector_byte_writer>;
 			using writer_type = vector_byte_writer;
 			using container_type = typename writer_type::container_type;
 			using size_type = typename container_type::size_type;
 
+		public:
+			static constexpr pointer program_offset = 0x200;
+
+			// Of the original 4K machine, beyond which calls are no longer inlined
+			static constexpr size_type program_capacity = (0x1000 - program_offset);
+
+			static constexpr size_type balanced_inline_size = (2 * sizeof(word));
+			static constexpr size_type balanced_loop_inline_size = (8 * sizeof(word));
+
+		private:
+			struct call_site
+			{
+				size_type offset;
+				const program * target;
+			};
+
 		private:
 			writer_type writer;
 			encoder_type encoder;
+			optimization level = optimization::none;
+			inlining policy = inlining::balanced;
+
+			std::vector<control_block> blocks;
+			size_type unresolved_count = 0;
+			size_type label_events = 0;
+
+			// Words that hold addresses within this program, which move with it when it is inlined or placed
+			std::vector<size_type> jump_offsets;
+			std::vector<call_site> call_sites;
+
+			bool is_closed = false;
+			bool has_return = false;
+
+			// Where the last return that always runs ends, and the label count when it was written,
+			// so a return placed as a subroutine's last word is not followed by another
+			size_type final_return_end = 0;
+			size_type final_return_label_events = 0;
 
 		public:
 			program()
@@ -30,6 +193,26 @@ namespace chip8
 			{
 			}
 
+			explicit program(optimization level)
+				: writer(), encoder(writer), level(level)
+			{
+			}
+
+			optimization get_optimization() const
+			{
+				return this->level;
+			}
+
+			inlining get_inlining() const
+			{
+				return this->policy;
+			}
+
+			void set_inlining(inlining policy)
+			{
+				this->policy = policy;
+			}
+
 			encoder_type & get_encoder()
 			{
 				return this->encoder;
@@ -39,6 +222,342 @@ namespace chip8
 			{
 				return this->writer.get_container();
 			}
+
+			size_type size() const
+			{
+				return this->writer.get_container().size();
+			}
+
+			void place(label & target)
+			{
+				target.set(this->size());
+				++this->label_events;
+
+				for(auto link = target.get_forward_reference_link(); link != 0;)
+				{
+					const auto offset = label::get_forward_reference_offset(link);
+					link = (this->read_word(offset) & 0x0FFF);
+
+					this->write_word(offset, encoding::address(0x1, static_cast<pointer>(program_offset + target.get_address())));
+					--this->unresolved_count;
+				}
+			}
+
+			void write_jump(label & target)
+			{
+				this->jump_offsets.push_back(this->size());
+
+				if(target.is_set())
+				{
+					this->encoder.encode_jump(static_cast<pointer>(target.get_address()));
+					return;
+				}
+
+				const auto link = target.add_forward_reference(this->size());
+				++this->unresolved_count;
+				++this->label_events;
+
+				this->writer.write_word_big_endian(encoding::address(0x1, static_cast<pointer>(link)));
+			}
+
+			// Either copies the body of the target here, or calls it where it is placed once the program ends
+			void write_call(const program & target)
+			{
+				if(this->should_inline(target))
+				{
+					this->append(target);
+					return;
+				}
+
+				this->call_sites.push_back(call_site { this->size(), &target });
+				this->encoder.encode_call(0);
+			}
+
+			void write_return()
+			{
+				const bool is_conditional = (this->size() >= sizeof(word)) && this->follows_skip();
+
+				this->has_return = true;
+				this->encoder.encode_return();
+
+				this->final_return_end = is_conditional ? 0 : this->size();
+				this->final_return_label_events = this->label_events;
+			}
+
+			// Whether the last word always returns and no label lies after it, so nothing can fall off the end
+			bool ends_with_return() const
+			{
+				return (this->final_return_end != 0) && (this->final_return_end == this->size()) && (this->final_return_label_events == this->label_events);
+			}
+
+			// Ends the body of a subroutine
+			void close()
+			{
+				if(!this->blocks.empty())
+					throw std::logic_error("program ends inside a block");
+
+				if(this->unresolved_count != 0)
+					throw std::logic_error("attempt to jump to unset label");
+
+				this->is_closed = true;
+			}
+
+			void finish()
+			{
+				this->close();
+				this->encoder.encode_exit();
+				this->place_subroutines();
+			}
+
+			// When the condition holds, skip_true skips the next instruction and skip_false does not
+			void begin_if(word skip_true, word skip_false)
+			{
+				this->blocks.emplace_back();
+				control_block & block = this->blocks.back();
+				block.kind = block_kind::if_block;
+
+				this->writer.write_word_big_endian(skip_true);
+				this->write_jump(block.exit);
+
+				block.body_start = this->size();
+				block.inverse_skip = skip_false;
+				block.label_events = this->label_events;
+			}
+
+			void begin_else()
+			{
+				control_block & block = this->get_block("else without if");
+
+				if(block.kind != block_kind::if_block)
+					throw std::logic_error("else without if");
+
+				block.kind = block_kind::else_block;
+				this->write_jump(block.end);
+				this->place(block.exit);
+			}
+
+			void finish_if()
+			{
+				control_block & block = this->get_block("end_if without if");
+
+				switch(block.kind)
+				{
+				case block_kind::if_block:
+					// A one-instruction body runs under the inverse skip alone, without the jump around it
+					if((this->size() - block.body_start) == sizeof(word) && block.label_events == this->label_events)
+					{
+						auto & container = this->get_writer_container();
+						const byte high = container[block.body_start + 0];
+						const byte low = container[block.body_start + 1];
+
+						container.resize(block.body_start - (sizeof(word) * 2));
+						this->writer.write_word_big_endian(block.inverse_skip);
+						this->writer.write_byte(high);
+						this->writer.write_byte(low);
+
+						--this->unresolved_count;
+						this->move_body_fixups(block.body_start);
+
+						// A return in the body now runs under the skip
+						this->final_return_end = 0;
+					}
+					else
+					{
+						this->place(block.exit);
+					}
+					break;
+
+				case block_kind::else_block:
+					this->place(block.end);
+					break;
+
+				default:
+					throw std::logic_error("end_if without if");
+				}
+
+				this->blocks.pop_back();
+			}
+
+			void begin_while(word skip_true)
+			{
+				this->blocks.emplace_back();
+				control_block & block = this->blocks.back();
+				block.kind = block_kind::while_block;
+
+				this->place(block.start);
+				this->writer.write_word_big_endian(skip_true);
+				this->write_jump(block.exit);
+			}
+
+			// The step is written as it would be in the body, then lifted out to be written again at the end
+			template< typename Statement >
+			void begin_for(word skip_true, Statement step)
+			{
+				this->begin_while(skip_true);
+
+				control_block & block = this->blocks.back();
+				block.kind = block_kind::for_block;
+
+				const size_type step_start = this->size();
+				const size_type events = this->label_events;
+				const size_type fixups = (this->jump_offsets.size() + this->call_sites.size());
+
+				*this, step;
+
+				if(this->label_events != events || (this->jump_offsets.size() + this->call_sites.size()) != fixups)
+					throw std::logic_error("the step of a for block may not jump or call");
+
+				auto & container = this->get_writer_container();
+				this->blocks.back().step.assign(std::begin(container) + step_start, std::end(container));
+				container.resize(step_start);
+				this->final_return_end = 0;
+			}
+
+			void finish_loop(block_kind kind, const char * message)
+			{
+				control_block & block = this->get_block(message);
+
+				if(block.kind != kind)
+					throw std::logic_error(message);
+
+				for(const byte value : block.step)
+					this->writer.write_byte(value);
+
+				this->write_jump(block.start);
+				this->place(block.exit);
+
+				this->blocks.pop_back();
+			}
+
+		private:
+			bool is_in_loop() const
+			{
+				for(const auto & block : this->blocks)
+					if(block.kind == block_kind::while_block || block.kind == block_kind::for_block)
+						return true;
+
+				return false;
+			}
+
+			// A body that returns early, or is still being written, as in a recursive call, is always called
+			bool should_inline(const program & target) const
+			{
+				if(!target.is_closed || target.has_return || (&target == this))
+					return false;
+
+				const size_type body_size = target.size();
+
+				if((this->size() + body_size) > program_capacity)
+					return false;
+
+				switch(this->policy)
+				{
+				case inlining::size:
+					return (body_size <= sizeof(word));
+				case inlining::balanced:
+					return (body_size <= balanced_inline_size) || (this->is_in_loop() && body_size <= balanced_loop_inline_size);
+				case inlining::speed:
+					return true;
+				default:
+					return false;
+				}
+			}
+
+			// Copies the body of source to the end of this program, moving its jumps and calls with it
+			void append(const program & source)
+			{
+				const size_type start = this->size();
+				const auto & body = source.writer.get_container();
+
+				auto & container = this->get_writer_container();
+				container.insert(std::end(container), std::begin(body), std::end(body));
+
+				for(const size_type offset : source.jump_offsets)
+				{
+					const word value = static_cast<word>((container[start + offset + 0] << 8) | (container[start + offset + 1] << 0));
+					this->write_word(start + offset, encoding::address(0x1, static_cast<pointer>((value & 0x0FFF) + start)));
+					this->jump_offsets.push_back(start + offset);
+				}
+
+				for(const auto & site : source.call_sites)
+					this->call_sites.push_back(call_site { start + site.offset, site.target });
+			}
+
+			// Places each subroutine that is still called after the exit, once, then points its calls at it.
+			// Placing a body brings its own calls along, so the list grows as it is walked.
+			void place_subroutines()
+			{
+				std::vector<call_site> placed;
+
+				for(size_type index = 0; index < this->call_sites.size(); ++index)
+				{
+					const call_site site = this->call_sites[index];
+
+					if(!site.target->is_closed)
+						throw std::logic_error("call to a subroutine that was never ended");
+
+					auto iterator = std::find_if(std::begin(placed), std::end(placed), [&site](const call_site & entry)
+					{
+						return (entry.target == site.target);
+					});
+
+					if(iterator == std::end(placed))
+					{
+						placed.push_back(call_site { this->size(), site.target });
+						iterator = std::prev(std::end(placed));
+
+						this->append(*site.target);
+
+						if(!site.target->ends_with_return())
+							this->encoder.encode_return();
+					}
+
+					this->write_word(site.offset, encoding::address(0x2, static_cast<pointer>(program_offset + iterator->offset)));
+				}
+			}
+
+			// After an if body of one instruction moves back over the jump that was removed from before it
+			void move_body_fixups(size_type body_start)
+			{
+				const size_type removed_jump = (body_start - sizeof(word));
+
+				this->jump_offsets.erase(std::remove(std::begin(this->jump_offsets), std::end(this->jump_offsets), removed_jump), std::end(this->jump_offsets));
+
+				for(auto & offset : this->jump_offsets)
+					if(offset == body_start)
+						offset = removed_jump;
+
+				for(auto & site : this->call_sites)
+					if(site.offset == body_start)
+						site.offset = removed_jump;
+			}
+
+			control_block & get_block(const char * message)
+			{
+				if(this->blocks.empty())
+					throw std::logic_error(message);
+
+				return this->blocks.back();
+			}
+
+			void write_word(size_type offset, word value)
+			{
+				auto & container = this->get_writer_container();
+				container[offset + 0] = static_cast<byte>((value >> 8) & 0xFF);
+				container[offset + 1] = static_cast<byte>((value >> 0) & 0xFF);
+			}
+
+			word read_word(size_type offset)
+			{
+				auto & container = this->get_writer_container();
+				return static_cast<word>((container[offset + 0] << 8) | (container[offset + 1] << 0));
+			}
+
+			bool follows_skip()
+			{
+				tagged_instruction previous { opcode_id::clear_screen };
+				return try_decode(this->read_word(this->size() - sizeof(word)), instruction_set::xo_chip, previous) && peephole_optimizer::is_skip(previous.get_opcode());
+			}
 		};
 
 		constexpr struct end_program_t {} end_program;
@@ -83,12 +602,12 @@ namespace chip8
 			register_id reg;
 		};
 
-		key_pressed_t key_pressed(register_id reg)
+		constexpr key_pressed_t key_pressed(register_id reg)
 		{
 			return { reg };
 		}
 
-		key_not_pressed_t operator !(key_pressed_t expression)
+		constexpr key_not_pressed_t operator !(key_pressed_t expression)
 		{
 			return { expression.reg };
 		}
@@ -97,18 +616,18 @@ namespace chip8
 		template< register_id reg >
 		struct register_t : std::integral_constant<register_id, reg>
 		{
-			load_register_immediate_t operator =(byte immediate) const
+			constexpr load_register_immediate_t operator =(byte immediate) const
 			{
 				return { reg, immediate };
 			}
 
 			template< register_id reg_1 >
-			load_register_register_t operator =(register_t<reg_1>) const
+			constexpr load_register_register_t operator =(register_t<reg_1>) const
 			{
 				return { reg, reg_1 };
 			}
 
-			await_key_t operator =(key_t) const
+			constexpr await_key_t operator =(key_t) const
 			{
 				return { reg };
 			}
@@ -139,7 +658,7 @@ namespace chip8
 			byte immediate;
 		};
 
-		register_equals_immediate_t operator ==(register_id reg, byte immediate)
+		constexpr register_equals_immediate_t operator ==(register_id reg, byte immediate)
 		{
 			return { reg, immediate };
 		}
@@ -151,7 +670,7 @@ namespace chip8
 			byte immediate;
 		};
 
-		register_not_equals_immediate_t operator !=(register_id reg, byte immediate)
+		constexpr register_not_equals_immediate_t operator !=(register_id reg, byte immediate)
 		{
 			return { reg, immediate };
 		}
@@ -164,7 +683,7 @@ namespace chip8
 		};
 
 		template< register_id reg_x, register_id reg_y >
-		register_equals_register_t operator ==(register_t<reg_x>, register_t<reg_y>)
+		constexpr register_equals_register_t operator ==(register_t<reg_x>, register_t<reg_y>)
 		{
 			return { reg_x, reg_y };
 		}
@@ -177,7 +696,7 @@ namespace chip8
 		};
 
 		template< register_id reg_x, register_id reg_y >
-		register_not_equals_register_t operator !=(register_t<reg_x>, register_t<reg_y>)
+		constexpr register_not_equals_register_t operator !=(register_t<reg_x>, register_t<reg_y>)
 		{
 			return { reg_x, reg_y };
 		}
@@ -259,13 +778,124 @@ namespace chip8
 		}
 
 
+		// The skip that is taken when a condition holds, for the block statements below
+		constexpr word get_skip(register_equals_immediate_t expression)
+		{
+			return encoding::special(0x3, expression.reg, expression.immediate);
+		}
+
+		constexpr word get_skip(register_not_equals_immediate_t expression)
+		{
+			return encoding::special(0x4, expression.reg, expression.immediate);
+		}
+
+		constexpr word get_skip(register_equals_register_t expression)
+		{
+			return encoding::special(0x5, expression.x, expression.y, 0x0);
+		}
+
+		constexpr word get_skip(register_not_equals_register_t expression)
+		{
+			return encoding::special(0x9, expression.x, expression.y, 0x0);
+		}
+
+		constexpr word get_skip(key_pressed_t expression)
+		{
+			return encoding::special(0xE, expression.reg, 0x9E);
+		}
+
+		constexpr word get_skip(key_not_pressed_t expression)
+		{
+			return encoding::special(0xE, expression.reg, 0xA1);
+		}
+
+		constexpr register_not_equals_immediate_t negate(register_equals_immediate_t expression)
+		{
+			return { expression.reg, expression.immediate };
+		}
+
+		constexpr register_equals_immediate_t negate(register_not_equals_immediate_t expression)
+		{
+			return { expression.reg, expression.immediate };
+		}
+
+		constexpr register_not_equals_register_t negate(register_equals_register_t expression)
+		{
+			return { expression.x, expression.y };
+		}
+
+		constexpr register_equals_register_t negate(register_not_equals_register_t expression)
+		{
+			return { expression.x, expression.y };
+		}
+
+		constexpr key_not_pressed_t negate(key_pressed_t expression)
+		{
+			return { expression.reg };
+		}
+
+		constexpr key_pressed_t negate(key_not_pressed_t expression)
+		{
+			return { expression.reg };
+		}
+
+
+		template< typename Condition >
+		struct if_t
+		{
+			Condition condition;
+		};
+
+		template< typename Condition >
+		constexpr if_t<Condition> if_(Condition condition)
+		{
+			return { condition };
+		}
+
+		constexpr struct else_t {} else_;
+
+		constexpr struct end_if_t {} end_if;
+
+
+		template< typename Condition >
+		struct while_t
+		{
+			Condition condition;
+		};
+
+		template< typename Condition >
+		constexpr while_t<Condition> while_(Condition condition)
+		{
+			return { condition };
+		}
+
+		constexpr struct end_while_t {} end_while;
+
+
+		template< typename Initialiser, typename Condition, typename Step >
+		struct for_t
+		{
+			Initialiser initialiser;
+			Condition condition;
+			Step step;
+		};
+
+		template< typename Initialiser, typename Condition, typename Step >
+		constexpr for_t<Initialiser, Condition, Step> for_(Initialiser initialiser, Condition condition, Step step)
+		{
+			return { initialiser, condition, step };
+		}
+
+		constexpr struct end_for_t {} end_for;
+
+
 		struct add_register_immediate_t
 		{
 			register_id reg;
 			byte immediate;
 		};
 
-		add_register_immediate_t operator +=(register_id reg, byte immediate)
+		constexpr add_register_immediate_t operator +=(register_id reg, byte immediate)
 		{
 			return { reg, immediate };
 		}
@@ -277,7 +907,7 @@ namespace chip8
 			register_id source;
 		};
 
-		add_register_register_t operator +=(register_id destination, register_id source)
+		constexpr add_register_register_t operator +=(register_id destination, register_id source)
 		{
 			return { destination, source };
 		}
@@ -289,7 +919,7 @@ namespace chip8
 			register_id source;
 		};
 
-		subtract_register_register_t operator -=(register_id destination, register_id source)
+		constexpr subtract_register_register_t operator -=(register_id destination, register_id source)
 		{
 			return { destination, source };
 		}
@@ -300,67 +930,31 @@ namespace chip8
 			register_id reg;
 		};
 
-		add_i_register_register_t operator +=(i_register_t, register_id reg)
+		constexpr add_i_register_register_t operator +=(i_register_t, register_id reg)
 		{
 			return { reg };
 		}
 
 
-		struct label
-		{
-		public:
-			using index_type = typename program::size_type;
-
-		private:
-			bool was_set = false;
-			index_type index = 0;
-
-			void set()
-			{
-				this->was_set = true;
-			}
-
-		public:
-			constexpr label() = default;
-
-			constexpr bool is_set() const
-			{
-				return this->was_set;
-			}
-
-			constexpr index_type get_address() const
-			{
-				return this->index;
-			}
-
-			void set(index_type index)
-			{
-				if(this->is_set())
-					throw std::logic_error("attempt to reassign a label");
-
-				this->index = index;
-				this->set();
-			}
-		};
-
+		// Holds the label by mutable reference, as a static_program records forward jumps in the label itself
 		struct jump_t
 		{
 		private:
-			const label & target;
+			label & target;
 
 		public:
-			constexpr jump_t(const label & target) :
+			constexpr jump_t(label & target) :
 				target(target)
 			{
 			}
 
-			constexpr const label & get_target() const
+			constexpr label & get_target() const
 			{
 				return this->target;
 			}
 		};
 
-		constexpr jump_t jump(const label & target)
+		constexpr jump_t jump(label & target)
 		{
 			return jump_t(target);
 		}
@@ -370,7 +964,7 @@ namespace chip8
 			register_id reg;
 		};
 
-		sprite_load_t load_sprite(register_id reg)
+		constexpr sprite_load_t load_sprite(register_id reg)
 		{
 			return { reg };
 		}
@@ -382,7 +976,7 @@ namespace chip8
 			byte size;
 		};
 
-		sprite_draw_t draw_sprite(register_id x, register_id y, byte size)
+		constexpr sprite_draw_t draw_sprite(register_id x, register_id y, byte size)
 		{
 			return { x, y, size };
 		}
@@ -391,22 +985,23 @@ namespace chip8
 
 		std::vector<byte> operator ,(program & program, end_program_t)
 		{
-			program.get_encoder().encode_exit();
+			program.finish();
+
+			if(program.get_optimization() == optimization::peephole)
+				peephole_optimizer().optimize(program.get_writer_container());
+
 			return std::move(program.get_writer_container());
 		}
 
 		program & operator ,(program & program, label & label_declaration)
 		{
-			label_declaration.set(program.get_writer_container().size());
+			program.place(label_declaration);
 			return program;
 		}
 
 		program & operator ,(program & program, jump_t jump)
 		{
-			if(!jump.get_target().is_set())
-				throw std::logic_error("attempt to jump to unset label");
-
-			program.get_encoder().encode_jump(jump.get_target().get_address());
+			program.write_jump(jump.get_target());
 			return program;
 		}
 
@@ -493,5 +1088,327 @@ namespace chip8
 			program.get_encoder().encode_draw(statement.x, statement.y, statement.size);
 			return program;
 		}
+
+		// A body of code for programs to call, written like a program and ended with end_subroutine.
+		// Labels are local to the program or subroutine that places them,
+		// and a subroutine must outlive the programs that call it until they end.
+		struct subroutine : program
+		{
+		};
+
+		constexpr struct end_subroutine_t {} end_subroutine;
+
+		struct call_t
+		{
+			const subroutine & target;
+		};
+
+		constexpr call_t call(const subroutine & target)
+		{
+			return { target };
+		}
+
+		program & operator ,(program & program, end_subroutine_t)
+		{
+			program.close();
+			return program;
+		}
+
+		program & operator ,(program & program, call_t statement)
+		{
+			program.write_call(statement.target);
+			return program;
+		}
+
+		program & operator ,(program & program, return_t)
+		{
+			program.write_return();
+			return program;
+		}
+
+		// Blocks are written as
+		//
+		//	if_(reg_0 == 1), ..., else_, ..., end_if,
+		//	while_(reg_0 != reg_1), ..., end_while,
+		//	for_(reg_0 = 0, reg_0 != 8, reg_0 += 1), ..., end_for,
+		//
+		// and lower to a skip that passes over a jump out of the block.
+		// An if with a one-instruction body and no else needs only the opposite skip.
+		template< typename Condition >
+		program & operator ,(program & program, if_t<Condition> statement)
+		{
+			program.begin_if(get_skip(statement.condition), get_skip(negate(statement.condition)));
+			return program;
+		}
+
+		program & operator ,(program & program, else_t)
+		{
+			program.begin_else();
+			return program;
+		}
+
+		program & operator ,(program & program, end_if_t)
+		{
+			program.finish_if();
+			return program;
+		}
+
+		template< typename Condition >
+		program & operator ,(program & program, while_t<Condition> statement)
+		{
+			program.begin_while(get_skip(statement.condition));
+			return program;
+		}
+
+		program & operator ,(program & program, end_while_t)
+		{
+			program.finish_loop(block_kind::while_block, "end_while without while");
+			return program;
+		}
+
+		template< typename Initialiser, typename Condition, typename Step >
+		program & operator ,(program & program, for_t<Initialiser, Condition, Step> statement)
+		{
+			program, statement.initialiser;
+			program.begin_for(get_skip(statement.condition), statement.step);
+			return program;
+		}
+
+		program & operator ,(program & program, end_for_t)
+		{
+			program.finish_loop(block_kind::for_block, "end_for without for");
+			return program;
+		}
+
+		// Builds a program inside a constant expression, for example:
+		//
+		//	constexpr static_program<64> create_program()
+		//	{
+		//		static_program<64> program;
+		//		label loop;
+		//		program, reg_0 = 0, loop, reg_0 += 1, jump(loop), end_program;
+		//		return program;
+		//	}
+		//
+		//	constexpr auto program = create_program();
+		//	constexpr auto rom = program.to_array<program.size()>();
+		//
+		// Jumps may refer to labels placed later in the program.
+		// Each such label remembers where it was used and patches those jumps once it is placed,
+		// because a constant may not hold pointers to the labels local to the function that built it.
+		template< std::size_t capacity >
+		struct static_program
+		{
+		public:
+			using size_type = std::size_t;
+
+		public:
+			static constexpr pointer program_offset = 0x200;
+
+		private:
+			byte bytes[capacity] {};
+			size_type byte_count = 0;
+			size_type unresolved_count = 0;
+
+		public:
+			constexpr size_type size() const
+			{
+				return this->byte_count;
+			}
+
+			constexpr byte operator[](size_type index) const
+			{
+				return this->bytes[index];
+			}
+
+			constexpr void write_word(word value)
+			{
+				if((capacity - this->byte_count) < sizeof(word))
+					throw std::length_error("static program is full");
+
+				this->write_word(this->byte_count, value);
+				this->byte_count += sizeof(word);
+			}
+
+			constexpr void write_jump(label & target)
+			{
+				if(target.is_set())
+				{
+					this->write_word(encoding::address(0x1, static_cast<pointer>(program_offset + target.get_address())));
+					return;
+				}
+
+				const auto link = target.add_forward_reference(this->byte_count);
+				++this->unresolved_count;
+
+				this->write_word(encoding::address(0x1, static_cast<pointer>(link)));
+			}
+
+			constexpr void place(label & target)
+			{
+				target.set(this->byte_count);
+
+				for(auto link = target.get_forward_reference_link(); link != 0;)
+				{
+					const auto offset = label::get_forward_reference_offset(link);
+					link = (this->read_word(offset) & 0x0FFF);
+
+					this->write_word(offset, encoding::address(0x1, static_cast<pointer>(program_offset + target.get_address())));
+					--this->unresolved_count;
+				}
+			}
+
+			constexpr void finish()
+			{
+				if(this->unresolved_count != 0)
+					throw std::logic_error("attempt to jump to unset label");
+
+				this->write_word(0x00FD);
+			}
+
+			template< size_type size >
+			constexpr std::array<byte, size> to_array() const
+			{
+				static_assert(size <= capacity, "array is larger than the program capacity");
+
+				return this->to_array(std::make_index_sequence<size>());
+			}
+
+		private:
+			constexpr void write_word(size_type offset, word value)
+			{
+				this->bytes[offset + 0] = static_cast<byte>((value >> 8) & 0xFF);
+				this->bytes[offset + 1] = static_cast<byte>((value >> 0) & 0xFF);
+			}
+
+			constexpr word read_word(size_type offset) const
+			{
+				return static_cast<word>((this->bytes[offset + 0] << 8) | (this->bytes[offset + 1] << 0));
+			}
+
+			template< size_type ... indices >
+			constexpr std::array<byte, sizeof...(indices)> to_array(std::index_sequence<indices...>) const
+			{
+				return std::array<byte, sizeof...(indices)> { { this->bytes[indices]... } };
+			}
+		};
+
+		template< std::size_t capacity >
+		constexpr static_program<capacity> & operator ,(static_program<capacity> & program, end_program_t)
+		{
+			program.finish();
+			return program;
+		}
+
+		template< std::size_t capacity >
+		constexpr static_program<capacity> & operator ,(static_program<capacity> & program, label & label_declaration)
+		{
+			program.place(label_declaration);
+			return program;
+		}
+
+		template< std::size_t capacity >
+		constexpr static_program<capacity> & operator ,(static_program<capacity> & program, jump_t jump)
+		{
+			program.write_jump(jump.get_target());
+			return program;
+		}
+
+		template< std::size_t capacity >
+		constexpr static_program<capacity> & operator ,(static_program<capacity> & program, add_register_immediate_t statement)
+		{
+			program.write_word(encoding::special(0x7, statement.reg, statement.immediate));
+			return program;
+		}
+
+		template< std::size_t capacity >
+		constexpr static_program<capacity> & operator ,(static_program<capacity> & program, add_register_register_t statement)
+		{
+			program.write_word(encoding::special(0x8, statement.destination, statement.source, 0x4));
+			return program;
+		}
+
+		template< std::size_t capacity >
+		constexpr static_program<capacity> & operator ,(static_program<capacity> & program, subtract_register_register_t statement)
+		{
+			program.write_word(encoding::special(0x8, statement.destination, statement.source, 0x5));
+			return program;
+		}
+
+		template< std::size_t capacity >
+		constexpr static_program<capacity> & operator ,(static_program<capacity> & program, load_register_immediate_t statement)
+		{
+			program.write_word(encoding::special(0x6, statement.reg, statement.immediate));
+			return program;
+		}
+
+		template< std::size_t capacity >
+		constexpr static_program<capacity> & operator ,(static_program<capacity> & program, load_register_register_t statement)
+		{
+			program.write_word(encoding::special(0x8, statement.destination, statement.source, 0x0));
+			return program;
+		}
+
+		template< std::size_t capacity >
+		constexpr static_program<capacity> & operator ,(static_program<capacity> & program, skip_if_t<register_equals_immediate_t> skip_statement)
+		{
+			const auto expression = skip_statement.expression;
+			program.write_word(encoding::special(0x3, expression.reg, expression.immediate));
+			return program;
+		}
+
+		template< std::size_t capacity >
+		constexpr static_program<capacity> & operator ,(static_program<capacity> & program, skip_if_t<register_not_equals_immediate_t> skip_statement)
+		{
+			const auto expression = skip_statement.expression;
+			program.write_word(encoding::special(0x4, expression.reg, expression.immediate));
+			return program;
+		}
+
+		template< std::size_t capacity >
+		constexpr static_program<capacity> & operator ,(static_program<capacity> & program, skip_if_t<register_equals_register_t> skip_statement)
+		{
+			const auto expression = skip_statement.expression;
+			program.write_word(encoding::special(0x5, expression.x, expression.y, 0x0));
+			return program;
+		}
+
+		template< std::size_t capacity >
+		constexpr static_program<capacity> & operator ,(static_program<capacity> & program, skip_if_t<register_not_equals_register_t> skip_statement)
+		{
+			const auto expression = skip_statement.expression;
+			program.write_word(encoding::special(0x9, expression.x, expression.y, 0x0));
+			return program;
+		}
+
+		template< std::size_t capacity >
+		constexpr static_program<capacity> & operator ,(static_program<capacity> & program, skip_if_t<key_pressed_t> skip_statement)
+		{
+			const auto expression = skip_statement.expression;
+			program.write_word(encoding::special(0xE, expression.reg, 0x9E));
+			return program;
+		}
+
+		template< std::size_t capacity >
+		constexpr static_program<capacity> & operator ,(static_program<capacity> & program, skip_if_t<key_not_pressed_t> skip_statement)
+		{
+			const auto expression = skip_statement.expression;
+			program.write_word(encoding::special(0xE, expression.reg, 0xA1));
+			return program;
+		}
+
+		template< std::size_t capacity >
+		constexpr static_program<capacity> & operator ,(static_program<capacity> & program, sprite_load_t statement)
+		{
+			program.write_word(encoding::special(0xF, statement.reg, 0x29));
+			return program;
+		}
+
+		template< std::size_t capacity >
+		constexpr static_program<capacity> & operator ,(static_program<capacity> & program, sprite_draw_t statement)
+		{
+			program.write_word(encoding::special(0xD, statement.x, statement.y, statement.size));
+			return program;
+		}
 	}
 }
\ No newline at end of file
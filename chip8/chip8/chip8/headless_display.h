@@ -0,0 +1,26 @@
+#pragma once
+
+#include "display.h"
+
+namespace chip8
+{
+	template< typename DisplayBuffer >
+	class basic_headless_display : public basic_display<DisplayBuffer>
+	{
+	public:
+		using display_buffer = DisplayBuffer;
+
+	public:
+		~basic_headless_display() override = default;
+
+		void update(const display_buffer &) override
+		{
+		}
+
+		void render() override
+		{
+		}
+	};
+
+	using headless_display = basic_headless_display<display::display_buffer>;
+}
\ No newline at end of file
@@ -0,0 +1,310 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+#include <deque>
+#include <memory>
+#include <array>
+#include <atomic>
+#include <mutex>
+#include <thread>
+#include <unordered_set>
+#include <algorithm>
+#include <stdexcept>
+
+#include "base_types.h"
+#include "keys.h"
+#include "keyboard.h"
+#include "movie.h"
+#include "headless_display.h"
+#include "processor.h"
+
+namespace chip8
+{
+	class scripted_keyboard : public keyboard
+	{
+	private:
+		key_state keys = 0;
+
+	public:
+		~scripted_keyboard() override = default;
+
+		key_state get_keys() const
+		{
+			return this->keys;
+		}
+
+		void set_keys(key_state keys)
+		{
+			this->keys = keys;
+		}
+
+		bool is_pressed(key_id key) const override
+		{
+			return ((this->keys & to_key_mask(key)) != 0);
+		}
+
+		void update() override
+		{
+		}
+	};
+
+	struct explorer_options
+	{
+		std::size_t thread_count = std::max(1u, std::thread::hardware_concurrency());
+		std::size_t cycles_per_frame = 64;
+
+		// Each input is held for this many frames before the next choice is made
+		std::size_t frames_per_input = 4;
+		std::uint64_t frame_limit = 1000000;
+		std::size_t max_queue_size = 65536;
+	};
+
+	// Explores key input sequences breadth-first across all threads.
+	// States are forked by save state, inputs that execute a new address are explored first,
+	// and states that have been seen before are dropped
+	template< typename Processor >
+	class input_explorer
+	{
+	public:
+		using processor_type = Processor;
+		using state_image_type = typename processor_type::state_image_type;
+		using size_type = std::size_t;
+
+	public:
+		static constexpr size_type address_count = processor_type::memory_type::capacity;
+		static constexpr size_type coverage_word_count = ((address_count + 63) / 64);
+
+		// Every single key, and no key at all
+		static constexpr size_type input_count = 17;
+
+	private:
+		struct entry
+		{
+			std::shared_ptr<const state_image_type> state;
+			std::vector<key_state> inputs;
+		};
+
+		using coverage_words = std::array<std::uint64_t, coverage_word_count>;
+
+		// Finishes a taken entry however its children end, so other threads never wait on it forever
+		struct finish_guard
+		{
+			input_explorer & explorer;
+
+			~finish_guard()
+			{
+				this->explorer.finish_entry();
+			}
+		};
+
+	private:
+		explorer_options options;
+
+		std::array<std::atomic<std::uint64_t>, coverage_word_count> coverage;
+		std::atomic<std::uint64_t> frame_count { 0 };
+
+		std::mutex queue_mutex;
+		std::deque<entry> new_coverage_queue;
+		std::deque<entry> queue;
+
+		// The number of entries taken but not yet finished, while it is non-zero the queues may still grow
+		size_type active_count = 0;
+
+		// Deduplication is only a search heuristic, so states are compared by hash alone
+		std::mutex state_mutex;
+		std::unordered_set<std::uint64_t> seen_states;
+
+		std::mutex discovery_mutex;
+		std::vector<std::vector<key_state>> discoveries;
+
+	public:
+		explicit input_explorer(explorer_options options = explorer_options()) :
+			options(options)
+		{
+			for(auto & word : this->coverage)
+				word.store(0, std::memory_order_relaxed);
+		}
+
+		// Blocks until the frame limit is reached or there is nothing left to explore
+		void explore(const state_image_type & initial_state)
+		{
+			this->queue.push_back(entry { std::make_shared<const state_image_type>(initial_state), {} });
+
+			std::vector<std::thread> threads;
+			for(size_type index = 0; index < this->options.thread_count; ++index)
+				threads.emplace_back([this]() { this->run_worker(); });
+
+			for(auto & thread : threads)
+				thread.join();
+		}
+
+		size_type get_covered_address_count() const
+		{
+			size_type result = 0;
+
+			for(const auto & word : this->coverage)
+				for(auto value = word.load(std::memory_order_relaxed); value != 0; value &= (value - 1))
+					++result;
+
+			return result;
+		}
+
+		bool is_covered(size_type address) const
+		{
+			return ((this->coverage[address / 64].load(std::memory_order_relaxed) & (UINT64_C(1) << (address % 64))) != 0);
+		}
+
+		std::uint64_t get_frame_count() const
+		{
+			return this->frame_count.load(std::memory_order_relaxed);
+		}
+
+		size_type get_unique_state_count() const
+		{
+			return this->seen_states.size();
+		}
+
+		// Input sequences, one entry per frames_per_input frames, that each reached new code
+		const std::vector<std::vector<key_state>> & get_discoveries() const
+		{
+			return this->discoveries;
+		}
+
+	private:
+		void run_worker()
+		{
+			auto keyboard = std::make_shared<scripted_keyboard>();
+			auto display = std::make_shared<basic_headless_display<typename processor_type::display_buffer_type>>();
+
+			auto processor = std::make_unique<processor_type>(display, keyboard);
+			auto state = std::make_unique<state_image_type>();
+
+			coverage_words local_coverage;
+
+			while(this->frame_count.load(std::memory_order_relaxed) < this->options.frame_limit)
+			{
+				entry parent;
+				if(!this->take(parent))
+					break;
+
+				const finish_guard guard { *this };
+
+				for(size_type input = 0; input < input_count; ++input)
+				{
+					const key_state keys = (input == 0) ? 0 : to_key_mask(static_cast<key_id>(input - 1));
+
+					local_coverage.fill(0);
+
+					// Random input easily reaches an undecodable word or overflows the call stack,
+					// which ends that path while keeping the code it covered on the way
+					bool is_dead_end = false;
+
+					try
+					{
+						processor->load_state(*parent.state);
+						keyboard->set_keys(keys);
+
+						for(size_type frame = 0; frame < this->options.frames_per_input; ++frame)
+						{
+							processor->run_traced(this->options.cycles_per_frame, [&local_coverage](pointer address)
+							{
+								local_coverage[(address % address_count) / 64] |= (UINT64_C(1) << (address % 64));
+							});
+							processor->update_timers();
+						}
+					}
+					catch(const std::exception &)
+					{
+						is_dead_end = true;
+					}
+
+					this->frame_count.fetch_add(this->options.frames_per_input, std::memory_order_relaxed);
+
+					const bool is_new_code = this->merge_coverage(local_coverage);
+
+					if(is_dead_end || !this->insert_state(processor->get_state_hash()) || processor->get_state() == processor_state::halted)
+						continue;
+
+					processor->save_state(*state);
+
+					entry child { std::make_shared<const state_image_type>(*state), parent.inputs };
+					child.inputs.push_back(keys);
+
+					if(is_new_code)
+					{
+						std::lock_guard<std::mutex> lock(this->discovery_mutex);
+						this->discoveries.push_back(child.inputs);
+					}
+
+					this->give(std::move(child), is_new_code);
+				}
+			}
+		}
+
+		// Threads stop once every queue is empty and no other thread can refill them
+		bool take(entry & result)
+		{
+			while(true)
+			{
+				{
+					std::lock_guard<std::mutex> lock(this->queue_mutex);
+
+					auto & source = !this->new_coverage_queue.empty() ? this->new_coverage_queue : this->queue;
+
+					if(!source.empty())
+					{
+						result = std::move(source.front());
+						source.pop_front();
+						++this->active_count;
+						return true;
+					}
+
+					if(this->active_count == 0)
+						return false;
+				}
+
+				std::this_thread::yield();
+			}
+		}
+
+		void finish_entry()
+		{
+			std::lock_guard<std::mutex> lock(this->queue_mutex);
+			--this->active_count;
+		}
+
+		void give(entry && child, bool is_new_code)
+		{
+			std::lock_guard<std::mutex> lock(this->queue_mutex);
+
+			if(is_new_code)
+				this->new_coverage_queue.push_back(std::move(child));
+			else if(this->queue.size() < this->options.max_queue_size)
+				this->queue.push_back(std::move(child));
+		}
+
+		bool merge_coverage(const coverage_words & local_coverage)
+		{
+			bool is_new = false;
+
+			for(size_type index = 0; index < coverage_word_count; ++index)
+				if(local_coverage[index] != 0)
+				{
+					const auto previous = this->coverage[index].fetch_or(local_coverage[index], std::memory_order_relaxed);
+
+					if((previous | local_coverage[index]) != previous)
+						is_new = true;
+				}
+
+			return is_new;
+		}
+
+		bool insert_state(std::uint64_t hash)
+		{
+			std::lock_guard<std::mutex> lock(this->state_mutex);
+			return this->seen_states.insert(hash).second;
+		}
+	};
+}
\ No newline at end of file
@@ -37,35 +37,86 @@ namespace chip8
 			return static_cast<byte>((instruction & 0x000F) >> 0);
 		}
 
-		tagged_instruction decode_special_0(word instruction)
+		bool decode_special_0(word instruction, instruction_set set, tagged_instruction & result)
 		{
 			switch(instruction)
 			{
 			case 0x00E0:
-				return { opcode_id::clear_screen };
+				result = tagged_instruction { opcode_id::clear_screen };
+				return true;
 			case 0x00EE:
-				return { opcode_id::function_return };
+				result = tagged_instruction { opcode_id::function_return };
+				return true;
 			case 0x00FD:
-				return { opcode_id::exit };
-			default:
-				throw std::exception();
+				result = tagged_instruction { opcode_id::exit };
+				return true;
+			}
+
+			if(set != instruction_set::chip8)
+			{
+				switch(instruction)
+				{
+				case 0x00FB:
+					result = tagged_instruction { opcode_id::scroll_right };
+					return true;
+				case 0x00FC:
+					result = tagged_instruction { opcode_id::scroll_left };
+					return true;
+				case 0x00FE:
+					result = tagged_instruction { opcode_id::low_resolution };
+					return true;
+				case 0x00FF:
+					result = tagged_instruction { opcode_id::high_resolution };
+					return true;
+				}
+
+				if((instruction & 0xFFF0) == 0x00C0)
+				{
+					result = instruction_immediate(opcode_id::scroll_down_immediate, get_function_type(instruction));
+					return true;
+				}
 			}
+
+			if(set == instruction_set::xo_chip)
+			{
+				if((instruction & 0xFFF0) == 0x00D0)
+				{
+					result = instruction_immediate(opcode_id::scroll_up_immediate, get_function_type(instruction));
+					return true;
+				}
+			}
+
+			return false;
 		}
 
-		tagged_instruction decode_special_5(word instruction)
+		bool decode_special_5(word instruction, instruction_set set, tagged_instruction & result)
 		{
 			byte function_type = get_function_type(instruction);
 
 			switch(function_type)
 			{
 			case 0x0:
-				return { opcode_id::skip_if_equal_register_register, get_x_register(instruction), get_y_register(instruction) };
-			default:
-				throw std::exception();
+				result = tagged_instruction { opcode_id::skip_if_equal_register_register, get_x_register(instruction), get_y_register(instruction) };
+				return true;
+			}
+
+			if(set == instruction_set::xo_chip)
+			{
+				switch(function_type)
+				{
+				case 0x2:
+					result = tagged_instruction { opcode_id::store_registers_range, get_x_register(instruction), get_y_register(instruction) };
+					return true;
+				case 0x3:
+					result = tagged_instruction { opcode_id::load_registers_range, get_x_register(instruction), get_y_register(instruction) };
+					return true;
+				}
 			}
+
+			return false;
 		}
 
-		tagged_instruction decode_special_8(word instruction)
+		bool decode_special_8(word instruction, tagged_instruction & result)
 		{
 			byte function_type = get_function_type(instruction);
 			auto destination = get_x_register(instruction);
@@ -74,42 +125,52 @@ namespace chip8
 			switch(function_type)
 			{
 			case 0x0:
-				return { opcode_id::load_register_register, destination, source };
+				result = tagged_instruction { opcode_id::load_register_register, destination, source };
+				return true;
 			case 0x1:
-				return { opcode_id::or_register_register, destination, source };
+				result = tagged_instruction { opcode_id::or_register_register, destination, source };
+				return true;
 			case 0x2:
-				return { opcode_id::and_register_register, destination, source };
+				result = tagged_instruction { opcode_id::and_register_register, destination, source };
+				return true;
 			case 0x3:
-				return { opcode_id::xor_register_register, destination, source };
+				result = tagged_instruction { opcode_id::xor_register_register, destination, source };
+				return true;
 			case 0x4:
-				return { opcode_id::add_register_register, destination, source };
+				result = tagged_instruction { opcode_id::add_register_register, destination, source };
+				return true;
 			case 0x5:
-				return { opcode_id::subtract_register_register, destination, source };
+				result = tagged_instruction { opcode_id::subtract_register_register, destination, source };
+				return true;
 			case 0x6:
-				return { opcode_id::shift_right_register_register, destination, source };
+				result = tagged_instruction { opcode_id::shift_right_register_register, destination, source };
+				return true;
 			case 0x7:
-				return { opcode_id::reverse_subtract_register_register, destination, source };
-			case 0x8:
-				return { opcode_id::shift_left_register_register, destination, source };
+				result = tagged_instruction { opcode_id::reverse_subtract_register_register, destination, source };
+				return true;
+			case 0xE:
+				result = tagged_instruction { opcode_id::shift_left_register_register, destination, source };
+				return true;
 			default:
-				throw std::exception();
+				return false;
 			}
 		}
 
-		tagged_instruction decode_special_9(word instruction)
+		bool decode_special_9(word instruction, tagged_instruction & result)
 		{
 			byte function_type = get_function_type(instruction);
 
 			switch(function_type)
 			{
 			case 0x0:
-				return { opcode_id::skip_if_not_equal_register_register, get_x_register(instruction), get_y_register(instruction) };
+				result = tagged_instruction { opcode_id::skip_if_not_equal_register_register, get_x_register(instruction), get_y_register(instruction) };
+				return true;
 			default:
-				throw std::exception();
+				return false;
 			}
 		}
 
-		tagged_instruction decode_special_e(word instruction)
+		bool decode_special_e(word instruction, tagged_instruction & result)
 		{
 			auto x = get_x_register(instruction);
 			auto function_type = get_immediate(instruction);
@@ -117,46 +178,90 @@ namespace chip8
 			switch(function_type)
 			{
 			case 0x9E:
-				return { opcode_id::skip_if_key_pressed_register, x };
+				result = tagged_instruction { opcode_id::skip_if_key_pressed_register, x };
+				return true;
 			case 0xA1:
-				return { opcode_id::skip_if_key_not_pressed_register, x };
+				result = tagged_instruction { opcode_id::skip_if_key_not_pressed_register, x };
+				return true;
 			default:
-				throw std::exception();
+				return false;
 			}
 		}
 
-		tagged_instruction decode_special_f(word instruction)
+		bool decode_special_f(word instruction, instruction_set set, tagged_instruction & result)
 		{
 			auto x = get_x_register(instruction);
 			auto function_type = get_immediate(instruction);
 
+			if(set == instruction_set::xo_chip)
+			{
+				// The address of F000 is held in the word that follows it
+				if(instruction == 0xF000)
+				{
+					result = tagged_instruction { opcode_id::load_i_long };
+					return true;
+				}
+
+				if(function_type == 0x01)
+				{
+					result = instruction_immediate(opcode_id::select_planes_immediate, static_cast<byte>(to_index(x)));
+					return true;
+				}
+			}
+
+			if(set != instruction_set::chip8)
+			{
+				switch(function_type)
+				{
+				case 0x30:
+					result = tagged_instruction { opcode_id::load_big_digit_sprite_register, x };
+					return true;
+				case 0x75:
+					result = tagged_instruction { opcode_id::store_flags_register, x };
+					return true;
+				case 0x85:
+					result = tagged_instruction { opcode_id::load_flags_register, x };
+					return true;
+				}
+			}
+
 			switch(function_type)
 			{
 			case 0x07:
-				return { opcode_id::read_delay_timer_register, x };
+				result = tagged_instruction { opcode_id::read_delay_timer_register, x };
+				return true;
 			case 0x0A:
-				return { opcode_id::await_key_press_register, x };
+				result = tagged_instruction { opcode_id::await_key_press_register, x };
+				return true;
 			case 0x15:
-				return { opcode_id::write_delay_timer_register, x };
+				result = tagged_instruction { opcode_id::write_delay_timer_register, x };
+				return true;
 			case 0x18:
-				return { opcode_id::write_sound_timer_register, x };
+				result = tagged_instruction { opcode_id::write_sound_timer_register, x };
+				return true;
 			case 0x1E:
-				return { opcode_id::add_i_register, x };
+				result = tagged_instruction { opcode_id::add_i_register, x };
+				return true;
 			case 0x29:
-				return { opcode_id::load_digit_sprite_register, x };
+				result = tagged_instruction { opcode_id::load_digit_sprite_register, x };
+				return true;
 			case 0x33:
-				return { opcode_id::load_bcd_register, x };
+				result = tagged_instruction { opcode_id::load_bcd_register, x };
+				return true;
 			case 0x55:
-				return { opcode_id::store_registers_i_register, x };
+				result = tagged_instruction { opcode_id::store_registers_i_register, x };
+				return true;
 			case 0x65:
-				return { opcode_id::load_registers_i_register, x };
+				result = tagged_instruction { opcode_id::load_registers_i_register, x };
+				return true;
 			default:
-				throw std::exception();
+				return false;
 			}
 		}
 	}
 
-	tagged_instruction decode_standard(word instruction)
+	// Reports words that are not instructions in the given set, such as sprite data, by returning false
+	bool try_decode(word instruction, instruction_set set, tagged_instruction & result)
 	{
 		byte most_significant_nibble = ((instruction >> 12) & 0x0F);
 
@@ -165,39 +270,64 @@ namespace chip8
 		switch(most_significant_nibble)
 		{
 		case 0x0:
-			return decode_special_0(instruction);
+			return decode_special_0(instruction, set, result);
 		case 0x1:
-			return { opcode_id::jump_address, get_address(instruction) };
+			result = tagged_instruction { opcode_id::jump_address, get_address(instruction) };
+			return true;
 		case 0x2:
-			return { opcode_id::call_address, get_address(instruction) };
+			result = tagged_instruction { opcode_id::call_address, get_address(instruction) };
+			return true;
 		case 0x3:
-			return { opcode_id::skip_if_equal_register_immediate, get_x_register(instruction), get_immediate(instruction) };
+			result = tagged_instruction { opcode_id::skip_if_equal_register_immediate, get_x_register(instruction), get_immediate(instruction) };
+			return true;
 		case 0x4:
-			return { opcode_id::skip_if_not_equal_register_immediate, get_x_register(instruction), get_immediate(instruction) };
+			result = tagged_instruction { opcode_id::skip_if_not_equal_register_immediate, get_x_register(instruction), get_immediate(instruction) };
+			return true;
 		case 0x5:
-			return decode_special_5(instruction);
+			return decode_special_5(instruction, set, result);
 		case 0x6:
-			return { opcode_id::load_register_immediate, get_x_register(instruction), get_immediate(instruction) };
+			result = tagged_instruction { opcode_id::load_register_immediate, get_x_register(instruction), get_immediate(instruction) };
+			return true;
 		case 0x7:
-			return { opcode_id::add_register_immediate, get_x_register(instruction), get_immediate(instruction) };
+			result = tagged_instruction { opcode_id::add_register_immediate, get_x_register(instruction), get_immediate(instruction) };
+			return true;
 		case 0x8:
-			return decode_special_8(instruction);
+			return decode_special_8(instruction, result);
 		case 0x9:
-			return decode_special_9(instruction);
+			return decode_special_9(instruction, result);
 		case 0xA:
-			return { opcode_id::load_i_immediate, get_address(instruction) };
+			result = tagged_instruction { opcode_id::load_i_immediate, get_address(instruction) };
+			return true;
 		case 0xB:
-			return { opcode_id::jump_address_register_0, get_address(instruction) };
+			result = tagged_instruction { opcode_id::jump_address_register_0, get_address(instruction) };
+			return true;
 		case 0xC:
-			return { opcode_id::random_register_immediate, get_x_register(instruction), get_immediate(instruction) };
+			result = tagged_instruction { opcode_id::random_register_immediate, get_x_register(instruction), get_immediate(instruction) };
+			return true;
 		case 0xD:
-			return { opcode_id::draw_x_y_size, get_x_register(instruction), get_y_register(instruction), get_sprite_size(instruction) };
+			result = tagged_instruction { opcode_id::draw_x_y_size, get_x_register(instruction), get_y_register(instruction), get_sprite_size(instruction) };
+			return true;
 		case 0xE:
-			return decode_special_e(instruction);
+			return decode_special_e(instruction, result);
 		case 0xF:
-			return decode_special_f(instruction);
+			return decode_special_f(instruction, set, result);
 		default:
-			throw std::exception();
+			return false;
 		}
 	}
+
+	tagged_instruction decode(word instruction, instruction_set set)
+	{
+		tagged_instruction result { opcode_id::clear_screen };
+
+		if(!try_decode(instruction, set, result))
+			throw std::exception();
+
+		return result;
+	}
+
+	tagged_instruction decode_standard(word instruction)
+	{
+		return decode(instruction, instruction_set::chip8);
+	}
 }
\ No newline at end of file
@@ -4,6 +4,9 @@
 #include <vector>
 #include <deque>
 #include <memory>
+#include <array>
+#include <algorithm>
+#include <stdexcept>
 
 #include "base_types.h"
 #include "opcodes.h"
@@ -39,8 +42,10 @@ namespace chip8
 		}
 	};
 
+	// Final, with word writers of its own that hide the ones in byte_writer,
+	// so that writing through a container_byte_writer itself makes no virtual calls
 	template< typename Container, typename std::enable_if<std::is_same<typename Container::value_type, byte>::value, int>::type = 0 >
-	class container_byte_writer : public byte_writer
+	class container_byte_writer final : public byte_writer
 	{
 	public:
 		using container_type = Container;
@@ -71,24 +76,222 @@ namespace chip8
 		{
 			this->container.push_back(value);
 		}
+
+		void write_word_big_endian(word value)
+		{
+			this->container.push_back(static_cast<byte>((value >> 8) & 0xFF));
+			this->container.push_back(static_cast<byte>((value >> 0) & 0xFF));
+		}
+
+		void write_word_little_endian(word value)
+		{
+			this->container.push_back(static_cast<byte>((value >> 0) & 0xFF));
+			this->container.push_back(static_cast<byte>((value >> 8) & 0xFF));
+		}
+
+		void write_bytes(const byte * values, std::size_t count)
+		{
+			this->container.insert(std::end(this->container), values, values + count);
+		}
 	};
 
 	using vector_byte_writer = container_byte_writer<std::vector<byte>>;
 	using deque_byte_writer = container_byte_writer<std::deque<byte>>;
 
-	class encoder
+	class writer_full_exception : public std::length_error
+	{
+	public:
+		writer_full_exception(const char * message) :
+			std::length_error(message)
+		{
+		}
+	};
+
+	// Writes into memory owned by someone else, such as a buffer on the stack, without allocating.
+	// Not a byte_writer, so it is only written through basic_encoder<span_byte_writer>, which makes no virtual calls.
+	class span_byte_writer
+	{
+	private:
+		byte * begin = nullptr;
+		byte * current = nullptr;
+		byte * end = nullptr;
+
+	public:
+		span_byte_writer() = default;
+
+		span_byte_writer(byte * begin, byte * end) :
+			begin(begin), current(begin), end(end)
+		{
+		}
+
+		span_byte_writer(byte * begin, std::size_t size) :
+			span_byte_writer(begin, begin + size)
+		{
+		}
+
+		const byte * data() const
+		{
+			return this->begin;
+		}
+
+		std::size_t size() const
+		{
+			return static_cast<std::size_t>(this->current - this->begin);
+		}
+
+		std::size_t capacity() const
+		{
+			return static_cast<std::size_t>(this->end - this->begin);
+		}
+
+		bool has_bytes_available(std::size_t amount) const
+		{
+			return (static_cast<std::size_t>(this->end - this->current) >= amount);
+		}
+
+		void write_byte(byte value)
+		{
+			this->reserve(1);
+			this->current[0] = value;
+			this->current += 1;
+		}
+
+		void write_word_big_endian(word value)
+		{
+			this->reserve(sizeof(word));
+			this->current[0] = static_cast<byte>((value >> 8) & 0xFF);
+			this->current[1] = static_cast<byte>((value >> 0) & 0xFF);
+			this->current += sizeof(word);
+		}
+
+		void write_word_little_endian(word value)
+		{
+			this->reserve(sizeof(word));
+			this->current[0] = static_cast<byte>((value >> 0) & 0xFF);
+			this->current[1] = static_cast<byte>((value >> 8) & 0xFF);
+			this->current += sizeof(word);
+		}
+
+		void write_bytes(const byte * values, std::size_t count)
+		{
+			this->reserve(count);
+			std::copy(values, values + count, this->current);
+			this->current += count;
+		}
+
+		void clear()
+		{
+			this->current = this->begin;
+		}
+
+	private:
+		void reserve(std::size_t amount) const
+		{
+			if(!this->has_bytes_available(amount))
+				throw writer_full_exception("byte writer is full");
+		}
+	};
+
+	// A span_byte_writer over storage of its own, such as the 3.5K of a program
+	template< std::size_t capacity >
+	class array_byte_writer
 	{
+	public:
+		using container_type = std::array<byte, capacity>;
+
 	private:
-		byte_writer & writer;
+		container_type container;
+		span_byte_writer span;
+
+	public:
+		array_byte_writer() :
+			container(), span(container.data(), container.size())
+		{
+		}
+
+		array_byte_writer(const array_byte_writer &) = delete;
+		array_byte_writer & operator =(const array_byte_writer &) = delete;
+
+		const byte * data() const
+		{
+			return this->container.data();
+		}
+
+		std::size_t size() const
+		{
+			return this->span.size();
+		}
+
+		bool has_bytes_available(std::size_t amount) const
+		{
+			return this->span.has_bytes_available(amount);
+		}
+
+		void write_byte(byte value)
+		{
+			this->span.write_byte(value);
+		}
+
+		void write_word_big_endian(word value)
+		{
+			this->span.write_word_big_endian(value);
+		}
+
+		void write_word_little_endian(word value)
+		{
+			this->span.write_word_little_endian(value);
+		}
+
+		void write_bytes(const byte * values, std::size_t count)
+		{
+			this->span.write_bytes(values, count);
+		}
+
+		void clear()
+		{
+			this->span.clear();
+		}
+	};
+
+	// Instruction layouts as constant expressions,
+	// shared by the encoder and by programs built at compile time
+	namespace encoding
+	{
+		constexpr word address(byte category, pointer address)
+		{
+			return static_cast<word>(((category & 0x0F) << 12) | ((address & 0x0FFF) << 0));
+		}
+
+		constexpr word special(byte category, register_id x, register_id y, byte function)
+		{
+			return static_cast<word>(((category & 0x0F) << 12) | ((to_index(x) & 0x0F) << 8) | ((to_index(y) & 0x0F) << 4) | ((function & 0x0F) << 0));
+		}
+
+		constexpr word special(byte category, register_id x, byte function)
+		{
+			return static_cast<word>(((category & 0x0F) << 12) | ((to_index(x) & 0x0F) << 8) | ((function & 0xFF) << 0));
+		}
+	}
+
+	// Writer is byte_writer, for any writer through virtual calls,
+	// or a concrete writer such as vector_byte_writer or span_byte_writer, whose calls are made directly
+	template< typename Writer >
+	class basic_encoder
+	{
+	public:
+		using writer_type = Writer;
+
+	private:
+		writer_type & writer;
 		pointer program_offset = 0x200;
 
 	public:
-		encoder(byte_writer & writer) :
+		basic_encoder(writer_type & writer) :
 			writer(writer)
 		{
 		}
 
-		encoder(byte_writer & writer, pointer program_offset) :
+		basic_encoder(writer_type & writer, pointer program_offset) :
 			writer(writer), program_offset(program_offset)
 		{
 		}
@@ -210,7 +413,7 @@ namespace chip8
 
 		void encode_shift_left(register_id destination, register_id source)
 		{
-			this->write_special(0x8, destination, source, 0x8);
+			this->write_special(0x8, destination, source, 0xE);
 		}
 
 		void encode_skip_if_key_pressed(register_id x)
@@ -228,6 +431,11 @@ namespace chip8
 			this->write_special(0xF, x, 0x07);
 		}
 
+		void encode_write_delay_timer(register_id x)
+		{
+			this->write_special(0xF, x, 0x15);
+		}
+
 		void encode_await_key_press(register_id x)
 		{
 			this->write_special(0xF, x, 0x0A);
@@ -263,50 +471,99 @@ namespace chip8
 			this->write_special(0xF, x, 0x65);
 		}
 
-	private:
-		void write_byte(byte value)
+		void encode_scroll_down(byte amount)
 		{
-			this->writer.write_byte(value);
+			this->write_word(0x00C0 | (amount & 0x0F));
 		}
 
-		void write_word(word value)
+		void encode_scroll_up(byte amount)
 		{
-			this->writer.write_word_big_endian(value);
+			this->write_word(0x00D0 | (amount & 0x0F));
 		}
 
-		void write_address(byte category, pointer address)
+		void encode_scroll_right()
 		{
-			const word instruction = (((category & 0x0F) << 12) | (((address + program_offset) & 0x0FFF) << 0));
-			this->write_word(instruction);
+			this->write_word(0x00FB);
 		}
 
-		word create_special(byte category_type, register_id register_x, register_id register_y, byte function_type)
+		void encode_scroll_left()
 		{
-			const byte category = (category_type & 0x0F);
-			const byte x = to_index(register_x);
-			const byte y = to_index(register_y);
-			const byte function = (function_type & 0x0F);
+			this->write_word(0x00FC);
+		}
 
-			return ((category << 12) | (x << 8) | (y << 4) | (function << 0));
+		void encode_low_resolution()
+		{
+			this->write_word(0x00FE);
 		}
 
-		void write_special(byte category, register_id x, register_id y, byte function)
+		void encode_high_resolution()
+		{
+			this->write_word(0x00FF);
+		}
+
+		void encode_load_big_digit_sprite(register_id x)
+		{
+			this->write_special(0xF, x, 0x30);
+		}
+
+		void encode_store_flags(register_id x)
+		{
+			this->write_special(0xF, x, 0x75);
+		}
+
+		void encode_load_flags(register_id x)
+		{
+			this->write_special(0xF, x, 0x85);
+		}
+
+		void encode_store_registers_range(register_id x, register_id y)
+		{
+			this->write_special(0x5, x, y, 0x2);
+		}
+
+		void encode_load_registers_range(register_id x, register_id y)
+		{
+			this->write_special(0x5, x, y, 0x3);
+		}
+
+		// Takes an absolute address, unlike the 12-bit address instructions
+		void encode_load_i_long(word address)
+		{
+			this->write_word(0xF000);
+			this->write_word(address);
+		}
+
+		void encode_select_planes(byte planes)
+		{
+			this->write_word(0xF001 | ((planes & 0x0F) << 8));
+		}
+
+	private:
+		void write_byte(byte value)
+		{
+			this->writer.write_byte(value);
+		}
+
+		void write_word(word value)
 		{
-			this->write_word(this->create_special(category, x, y, function));
+			this->writer.write_word_big_endian(value);
 		}
 
-		word create_special(byte category_type, register_id register_x, byte function_type)
+		void write_address(byte category, pointer address)
 		{
-			const byte category = (category_type & 0x0F);
-			const byte x = to_index(register_x);
-			const byte function = (function_type & 0xFF);
+			this->write_word(encoding::address(category, static_cast<pointer>(address + this->program_offset)));
+		}
 
-			return ((category << 12) | (x << 8) | (function << 0));
+		void write_special(byte category, register_id x, register_id y, byte function)
+		{
+			this->write_word(encoding::special(category, x, y, function));
 		}
 
 		void write_special(byte category, register_id x, byte function)
 		{
-			this->write_word(this->create_special(category, x, function));
+			this->write_word(encoding::special(category, x, function));
 		}
 	};
+
+	using encoder = basic_encoder<byte_writer>;
 }
\ No newline at end of file
@@ -37,6 +37,16 @@ namespace chip8
 		}
 	};
 
+	struct instruction_immediate : instruction_base
+	{
+		byte immediate;
+
+		constexpr instruction_immediate(opcode_id opcode, byte immediate)
+			: instruction_base(opcode), immediate(immediate)
+		{
+		}
+	};
+
 	struct instruction_register : instruction_base
 	{
 		register_id reg;
@@ -89,6 +99,7 @@ namespace chip8
 			unknown,
 			no_arguments,
 			address,
+			immediate,
 			reg,
 			register_immediate,
 			register_register,
@@ -99,6 +110,7 @@ namespace chip8
 		{
 			instruction_no_arguments no_arguments;
 			instruction_address address;
+			instruction_immediate immediate;
 			instruction_register reg;
 			instruction_register_immediate register_immediate;
 			instruction_register_register register_register;
@@ -114,6 +126,11 @@ namespace chip8
 			{
 			}
 
+			constexpr instruction_data(instruction_immediate instruction)
+				: immediate(instruction)
+			{
+			}
+
 			constexpr instruction_data(instruction_register instruction)
 				: reg(instruction)
 			{
@@ -159,6 +176,11 @@ namespace chip8
 		{
 		}
 
+		constexpr tagged_instruction(instruction_immediate instruction)
+			: tag(instruction_tag::immediate), data(instruction)
+		{
+		}
+
 		constexpr tagged_instruction(instruction_register instruction)
 			: tag(instruction_tag::reg), data(instruction)
 		{
@@ -207,6 +229,8 @@ namespace chip8
 				return this->data.no_arguments.opcode;
 			case instruction_tag::address:
 				return this->data.address.opcode;
+			case instruction_tag::immediate:
+				return this->data.immediate.opcode;
 			case instruction_tag::reg:
 				return this->data.reg.opcode;
 			case instruction_tag::register_register:
@@ -262,6 +286,9 @@ namespace chip8
 			if(this->tag == instruction_tag::register_immediate)
 				return this->data.register_immediate.immediate;
 
+			if(this->tag == instruction_tag::immediate)
+				return this->data.immediate.immediate;
+
 			throw std::exception();
 		}
 
@@ -305,6 +332,14 @@ namespace chip8
 			throw std::exception();
 		}
 
+		instruction_immediate get_instruction_immediate() const
+		{
+			if(this->tag == instruction_tag::immediate)
+				return this->data.immediate;
+
+			throw std::exception();
+		}
+
 		instruction_register get_instruction_register() const
 		{
 			if(this->tag == instruction_tag::reg)
@@ -355,6 +390,14 @@ namespace chip8
 			throw std::exception();
 		}
 
+		operator instruction_immediate() const
+		{
+			if(this->tag == instruction_tag::immediate)
+				return this->data.immediate;
+
+			throw std::exception();
+		}
+
 		operator instruction_register() const
 		{
 			if(this->tag == instruction_tag::reg)
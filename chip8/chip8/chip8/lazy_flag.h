@@ -0,0 +1,64 @@
+#pragma once
+
+#include "base_types.h"
+
+namespace chip8
+{
+	enum class flag_operation : byte
+	{
+		none,
+		carry,
+		no_borrow,
+		shift_right,
+		shift_left,
+	};
+
+	// Records the last flag-producing operation so that VF
+	// is only computed if something actually reads it
+	struct lazy_flag
+	{
+	public:
+		flag_operation operation = flag_operation::none;
+		byte left = 0;
+		byte right = 0;
+
+	public:
+		bool is_pending() const
+		{
+			return (this->operation != flag_operation::none);
+		}
+
+		void set(flag_operation operation, byte left, byte right)
+		{
+			this->operation = operation;
+			this->left = left;
+			this->right = right;
+		}
+
+		void clear()
+		{
+			this->operation = flag_operation::none;
+		}
+
+		byte evaluate() const
+		{
+			switch(this->operation)
+			{
+			case flag_operation::carry:
+				return (((this->left + this->right) > 0xFF) ? 1 : 0);
+
+			case flag_operation::no_borrow:
+				return ((this->left >= this->right) ? 1 : 0);
+
+			case flag_operation::shift_right:
+				return static_cast<byte>((this->left >> 0) & 0x01);
+
+			case flag_operation::shift_left:
+				return static_cast<byte>((this->left >> 7) & 0x01);
+
+			default:
+				return 0;
+			}
+		}
+	};
+}
\ No newline at end of file
@@ -0,0 +1,260 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <memory>
+#include <ostream>
+#include <iomanip>
+#include <algorithm>
+#include <utility>
+#include <stdexcept>
+
+#include "base_types.h"
+#include "processor.h"
+
+namespace chip8
+{
+	// Runs a reference processor and a processor driven by an alternative engine side by side,
+	// comparing their full states, memory included, every interval cycles.
+	// Each checkpoint is only taken once both processors are known to be identical.
+	// When they differ, both processors are restored to the last checkpoint
+	// and the first diverging cycle is found by bisection over exact state comparisons.
+	// Keyboards must give the same answers when a processor is rewound with load_state
+	template< typename Processor >
+	class lockstep_validator
+	{
+	public:
+		using processor_type = Processor;
+		using state_image_type = typename processor_type::state_image_type;
+		using size_type = std::size_t;
+
+	public:
+		static constexpr size_type default_interval = 1024;
+
+	private:
+		using state_image_pointer = std::unique_ptr<state_image_type>;
+
+	private:
+		processor_type & reference;
+		processor_type & candidate;
+		size_type interval;
+
+		bool has_diverged_value = false;
+		std::uint64_t cycle_count = 0;
+		std::uint64_t divergence_cycle = 0;
+
+		state_image_pointer checkpoint = std::make_unique<state_image_type>();
+		state_image_pointer reference_state = std::make_unique<state_image_type>();
+		state_image_pointer candidate_state = std::make_unique<state_image_type>();
+
+	public:
+		lockstep_validator(processor_type & reference, processor_type & candidate) :
+			lockstep_validator(reference, candidate, default_interval)
+		{
+		}
+
+		lockstep_validator(processor_type & reference, processor_type & candidate, size_type interval) :
+			reference(reference), candidate(candidate), interval(interval)
+		{
+			if(interval == 0)
+				throw std::invalid_argument("interval must be greater than zero");
+		}
+
+		bool has_diverged() const
+		{
+			return this->has_diverged_value;
+		}
+
+		std::uint64_t get_cycle_count() const
+		{
+			return this->cycle_count;
+		}
+
+		// The number of cycles that matched before the first diverging one
+		std::uint64_t get_divergence_cycle() const
+		{
+			return this->divergence_cycle;
+		}
+
+		// The state both processors were in before the diverging cycle
+		const state_image_type & get_divergence_origin() const
+		{
+			return *this->checkpoint;
+		}
+
+		const state_image_type & get_reference_state() const
+		{
+			return *this->reference_state;
+		}
+
+		const state_image_type & get_candidate_state() const
+		{
+			return *this->candidate_state;
+		}
+
+		// Engine must provide run_cycles(processor_type &, size_type).
+		// Returns false if the processors diverged
+		template< typename Engine >
+		bool run(Engine & engine, std::uint64_t cycle_limit)
+		{
+			if(this->has_diverged_value)
+				return false;
+
+			if(!this->save_states())
+			{
+				// The processors differed before running a single cycle
+				this->reference.save_state(*this->checkpoint);
+				this->has_diverged_value = true;
+				this->divergence_cycle = this->cycle_count;
+				return false;
+			}
+
+			std::swap(this->checkpoint, this->reference_state);
+
+			while(this->cycle_count < cycle_limit)
+			{
+				const auto step = static_cast<size_type>(std::min<std::uint64_t>(this->interval, cycle_limit - this->cycle_count));
+
+				this->reference.run_cycles(step);
+				engine.run_cycles(this->candidate, step);
+
+				if(!this->save_states())
+				{
+					this->bisect(engine, step);
+					return false;
+				}
+
+				this->cycle_count += step;
+
+				if(this->reference.get_state() == processor_state::halted && this->candidate.get_state() == processor_state::halted)
+					break;
+
+				std::swap(this->checkpoint, this->reference_state);
+			}
+
+			return true;
+		}
+
+		void write_report(std::ostream & output) const
+		{
+			if(!this->has_diverged_value)
+			{
+				output << "no divergence in " << this->cycle_count << " cycles\n";
+				return;
+			}
+
+			const auto & origin = *this->checkpoint;
+			const auto & left = *this->reference_state;
+			const auto & right = *this->candidate_state;
+
+			const auto program_counter = origin.program_counter.get();
+
+			output << std::hex << std::setfill('0');
+			output << "divergence at cycle " << std::dec << this->divergence_cycle << std::hex
+				<< ", pc " << std::setw(4) << program_counter
+				<< ", instruction " << std::setw(2) << static_cast<unsigned>(origin.memory[program_counter % sizeof(origin.memory)])
+				<< std::setw(2) << static_cast<unsigned>(origin.memory[(program_counter + 1) % sizeof(origin.memory)]) << '\n';
+
+			output << "            reference candidate\n";
+			write_row(output, "pc", left.program_counter.get(), right.program_counter.get());
+			write_row(output, "i", left.i_register.get(), right.i_register.get());
+			write_row(output, "state", left.state, right.state);
+			write_row(output, "dt", left.delay_timer, right.delay_timer);
+			write_row(output, "st", left.sound_timer, right.sound_timer);
+			write_row(output, "sp", left.call_stack_size, right.call_stack_size);
+
+			for(std::size_t index = 0; index < sizeof(left.registers); ++index)
+			{
+				const char name[] { 'v', "0123456789ABCDEF"[index], '\0' };
+				write_row(output, name, left.registers[index], right.registers[index]);
+			}
+
+			for(std::size_t index = 0; index < (sizeof(left.call_stack) / sizeof(left.call_stack[0])); ++index)
+				if(left.call_stack[index].get() != right.call_stack[index].get())
+					output << "stack[" << index << "] " << std::setw(4) << left.call_stack[index].get() << ' ' << std::setw(4) << right.call_stack[index].get() << '\n';
+
+			write_differences(output, "display", left.display, right.display);
+			write_differences(output, "memory", left.memory, right.memory);
+
+			output << std::dec << std::setfill(' ');
+		}
+
+	private:
+		template< typename Engine >
+		void bisect(Engine & engine, size_type step)
+		{
+			// The largest number of cycles known to match and the smallest known to differ
+			size_type matching = 0;
+			size_type differing = step;
+
+			while((differing - matching) > 1)
+			{
+				const size_type middle = (matching + ((differing - matching) / 2));
+
+				if(this->run_from_checkpoint(engine, middle))
+					matching = middle;
+				else
+					differing = middle;
+			}
+
+			// Leave both processors just before the diverging cycle, with that state kept as the origin
+			static_cast<void>(this->run_from_checkpoint(engine, matching));
+			this->reference.save_state(*this->checkpoint);
+
+			static_cast<void>(this->run_from_checkpoint(engine, 1));
+
+			this->has_diverged_value = true;
+			this->divergence_cycle = (this->cycle_count + matching);
+			this->cycle_count = this->divergence_cycle;
+		}
+
+		// Returns whether both processors are identical after running cycles from the checkpoint
+		template< typename Engine >
+		bool run_from_checkpoint(Engine & engine, size_type cycles)
+		{
+			this->reference.load_state(*this->checkpoint);
+			this->candidate.load_state(*this->checkpoint);
+
+			this->reference.run_cycles(cycles);
+			engine.run_cycles(this->candidate, cycles);
+
+			return this->save_states();
+		}
+
+		// Returns whether both processors are identical, including their memory
+		bool save_states()
+		{
+			this->reference.save_state(*this->reference_state);
+			this->candidate.save_state(*this->candidate_state);
+
+			return (std::memcmp(this->reference_state.get(), this->candidate_state.get(), sizeof(state_image_type)) == 0);
+		}
+
+		static void write_row(std::ostream & output, const char * name, unsigned left, unsigned right)
+		{
+			output << std::setfill(' ') << std::setw(10) << name << std::setfill('0')
+				<< "  " << std::setw(4) << left << "      " << std::setw(4) << right
+				<< ((left != right) ? "  <\n" : "\n");
+		}
+
+		template< std::size_t size >
+		static void write_differences(std::ostream & output, const char * name, const byte(&left)[size], const byte(&right)[size])
+		{
+			constexpr std::size_t limit = 16;
+
+			std::size_t count = 0;
+			for(std::size_t index = 0; index < size; ++index)
+				if(left[index] != right[index])
+				{
+					if(count < limit)
+						output << name << '[' << std::setw(4) << index << "] " << std::setw(2) << static_cast<unsigned>(left[index]) << ' ' << std::setw(2) << static_cast<unsigned>(right[index]) << '\n';
+
+					++count;
+				}
+
+			if(count > limit)
+				output << name << ": " << std::dec << (count - limit) << std::hex << " more differences\n";
+		}
+	};
+}
\ No newline at end of file
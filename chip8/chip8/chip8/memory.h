@@ -1 +1,458 @@
 #pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <array>
+#include <memory>
+#include <iterator>
+#include <algorithm>
+#include <stdexcept>
+
+#include "base_types.h"
+#include "state_hash.h"
+
+namespace chip8
+{
+	template< std::size_t capacity_value >
+	using memory_image = byte_array<capacity_value>;
+
+	template< std::size_t capacity_value >
+	using memory_image_pointer = std::shared_ptr<const memory_image<capacity_value>>;
+
+	template< std::size_t capacity_value, std::size_t page_size_value = 0x100 >
+	class paged_memory
+	{
+	public:
+		using size_type = std::size_t;
+
+	public:
+		static constexpr size_type capacity = capacity_value;
+		static constexpr size_type page_size = page_size_value;
+		static constexpr size_type page_count = (capacity / page_size);
+
+		// Addresses wrap around the capacity, so a single mask replaces bounds checks
+		static constexpr size_type address_mask = (capacity - 1);
+
+		static_assert((capacity & address_mask) == 0, "capacity must be a power of two");
+		static_assert((capacity % page_size) == 0, "capacity must be a multiple of page size");
+
+	public:
+		using image_type = memory_image<capacity>;
+		using image_pointer = memory_image_pointer<capacity>;
+		using page_type = byte_array<page_size>;
+
+	private:
+		using page_pointer = std::unique_ptr<page_type>;
+
+	private:
+		image_pointer image;
+		std::array<const byte *, page_count> pages;
+		std::array<page_pointer, page_count> private_pages;
+
+		// Bumped on every write, so cached views of memory can detect that they are stale
+		std::array<std::uint32_t, page_count> page_generations {};
+		std::uint64_t generation = 0;
+
+		std::uint64_t hash = 0;
+
+	public:
+		paged_memory() :
+			paged_memory(get_empty_image())
+		{
+		}
+
+		paged_memory(image_pointer image)
+		{
+			this->load_image(std::move(image));
+		}
+
+		paged_memory(const paged_memory & other) :
+			image(other.image), page_generations(other.page_generations), generation(other.generation), hash(other.hash)
+		{
+			for(size_type page_index = 0; page_index < page_count; ++page_index)
+			{
+				if(other.private_pages[page_index] != nullptr)
+					this->private_pages[page_index].reset(new page_type(*other.private_pages[page_index]));
+
+				this->bind_page(page_index);
+			}
+		}
+
+		paged_memory(paged_memory && other) = default;
+
+		paged_memory & operator =(const paged_memory & other)
+		{
+			if(this != &other)
+			{
+				paged_memory copy(other);
+				this->swap(copy);
+			}
+			return *this;
+		}
+
+		paged_memory & operator =(paged_memory && other) = default;
+
+		void swap(paged_memory & other) noexcept
+		{
+			std::swap(this->image, other.image);
+			this->pages.swap(other.pages);
+			this->private_pages.swap(other.private_pages);
+			this->page_generations.swap(other.page_generations);
+			std::swap(this->generation, other.generation);
+			std::swap(this->hash, other.hash);
+		}
+
+		const image_pointer & get_image() const
+		{
+			return this->image;
+		}
+
+		void load_image(image_pointer image)
+		{
+			if(image == nullptr)
+				throw std::invalid_argument("memory image must not be null");
+
+			this->image = std::move(image);
+
+			for(size_type page_index = 0; page_index < page_count; ++page_index)
+			{
+				this->private_pages[page_index].reset();
+				this->bind_page(page_index);
+				this->touch_page(page_index);
+			}
+
+			this->hash = state_hash_helpers::hash_range(state_hash_helpers::memory_salt, 0, this->image->data(), this->image->data() + capacity);
+		}
+
+		bool is_page_shared(size_type page_index) const
+		{
+			return (this->private_pages[page_index] == nullptr);
+		}
+
+		std::uint32_t get_page_generation(size_type page_index) const
+		{
+			return this->page_generations[page_index];
+		}
+
+		std::uint64_t get_generation() const
+		{
+			return this->generation;
+		}
+
+		// Maintained on every write rather than computed on demand
+		std::uint64_t get_hash() const
+		{
+			return this->hash;
+		}
+
+		size_type get_private_page_count() const
+		{
+			return static_cast<size_type>(std::count_if(std::begin(this->private_pages), std::end(this->private_pages), [](const page_pointer & page) { return (page != nullptr); }));
+		}
+
+		byte read(size_type address) const
+		{
+			address &= address_mask;
+			return this->pages[address / page_size][address % page_size];
+		}
+
+		byte operator[](size_type address) const
+		{
+			return this->read(address);
+		}
+
+		void write(size_type address, byte value)
+		{
+			address &= address_mask;
+
+			byte & destination = this->get_writable_page(address / page_size)[address % page_size];
+			this->hash = state_hash_helpers::update(this->hash, state_hash_helpers::memory_salt, address, destination, value);
+			destination = value;
+
+			this->touch_page(address / page_size);
+		}
+
+		template< typename InputIterator >
+		void write(size_type address, InputIterator begin, InputIterator end)
+		{
+			const auto input_size = static_cast<size_type>(std::distance(begin, end));
+
+			if(address > capacity || input_size > (capacity - address))
+				throw std::length_error("provided range of elements exceeds memory capacity");
+
+			while(begin != end)
+			{
+				const size_type page_index = (address / page_size);
+				const size_type page_offset = (address % page_size);
+				const size_type page_remaining = (page_size - page_offset);
+
+				byte * destination = &this->get_writable_page(page_index)[page_offset];
+				this->touch_page(page_index);
+
+				for(size_type index = 0; index < page_remaining && begin != end; ++index, ++begin, ++address)
+				{
+					const byte value = *begin;
+					this->hash = state_hash_helpers::update(this->hash, state_hash_helpers::memory_salt, address, destination[index], value);
+					destination[index] = value;
+				}
+			}
+		}
+
+		// Replaces the entire contents of memory,
+		// pages that match the shared image are left shared
+		void assign(const byte * data)
+		{
+			for(size_type page_index = 0; page_index < page_count; ++page_index)
+			{
+				const byte * source = &data[page_index * page_size];
+				const byte * shared = &(*this->image)[page_index * page_size];
+				const bool is_changed = !std::equal(source, source + page_size, this->pages[page_index]);
+
+				if(is_changed)
+				{
+					const byte * current = this->pages[page_index];
+					this->hash -= state_hash_helpers::hash_range(state_hash_helpers::memory_salt, page_index * page_size, current, current + page_size);
+					this->hash += state_hash_helpers::hash_range(state_hash_helpers::memory_salt, page_index * page_size, source, source + page_size);
+				}
+
+				if(std::equal(source, source + page_size, shared))
+				{
+					this->private_pages[page_index].reset();
+					this->bind_page(page_index);
+				}
+				else if(is_changed)
+				{
+					std::copy_n(source, page_size, this->get_writable_page(page_index));
+				}
+
+				if(is_changed)
+					this->touch_page(page_index);
+			}
+		}
+
+		template< typename OutputIterator >
+		OutputIterator read(size_type address, size_type count, OutputIterator output) const
+		{
+			if(address > capacity || count > (capacity - address))
+				throw std::length_error("requested range of elements exceeds memory capacity");
+
+			while(count > 0)
+			{
+				const size_type page_index = (address / page_size);
+				const size_type page_offset = (address % page_size);
+				const size_type amount = std::min(count, (page_size - page_offset));
+
+				const byte * source = &this->pages[page_index][page_offset];
+				output = std::copy(source, source + amount, output);
+
+				address += amount;
+				count -= amount;
+			}
+
+			return output;
+		}
+
+		// Gives direct access to length bytes from address, which must all lie in one page, for filling memory in place.
+		// The hash and generations do not follow writes through the window until it is closed with the same range.
+		byte * open_window(size_type address, size_type length)
+		{
+			byte * window = &this->get_writable_page(address / page_size)[address % page_size];
+			this->hash -= state_hash_helpers::hash_range(state_hash_helpers::memory_salt, address, window, window + length);
+			return window;
+		}
+
+		void close_window(size_type address, size_type length)
+		{
+			const byte * window = &this->private_pages[address / page_size]->data()[address % page_size];
+			this->hash += state_hash_helpers::hash_range(state_hash_helpers::memory_salt, address, window, window + length);
+			this->touch_page(address / page_size);
+		}
+
+	private:
+		static const image_pointer & get_empty_image()
+		{
+			static const image_pointer empty_image = std::make_shared<const image_type>();
+			return empty_image;
+		}
+
+		void bind_page(size_type page_index)
+		{
+			const auto & private_page = this->private_pages[page_index];
+
+			this->pages[page_index] = (private_page != nullptr) ? private_page->data() : &(*this->image)[page_index * page_size];
+		}
+
+		void touch_page(size_type page_index)
+		{
+			++this->page_generations[page_index];
+			++this->generation;
+		}
+
+		byte * get_writable_page(size_type page_index)
+		{
+			auto & private_page = this->private_pages[page_index];
+
+			if(private_page == nullptr)
+			{
+				const auto shared_begin = std::next(std::begin(*this->image), page_index * page_size);
+
+				private_page.reset(new page_type());
+				std::copy_n(shared_begin, page_size, std::begin(*private_page));
+
+				this->bind_page(page_index);
+			}
+
+			return private_page->data();
+		}
+	};
+
+	// A writer for basic_encoder that fills a range of memory in place, a page at a time,
+	// so a program can be encoded where it will run without an intermediate buffer.
+	// Writes are only reflected in the memory hash once the writer moves past a page, is flushed or is destroyed.
+	template< typename Memory >
+	class memory_byte_writer
+	{
+	public:
+		using memory_type = Memory;
+		using size_type = typename memory_type::size_type;
+
+	private:
+		memory_type * memory = nullptr;
+
+		size_type begin = 0;
+		size_type end = 0;
+
+		// Where the next window opens
+		size_type address = 0;
+
+		size_type window_address = 0;
+		byte * window_begin = nullptr;
+		byte * current = nullptr;
+		byte * window_end = nullptr;
+
+	public:
+		memory_byte_writer(memory_type & memory, size_type begin, size_type end) :
+			memory(&memory), begin(begin), end(end), address(begin), window_address(begin)
+		{
+			if(begin > end || end > memory_type::capacity)
+				throw std::length_error("requested range of elements exceeds memory capacity");
+		}
+
+		memory_byte_writer(memory_byte_writer && other) :
+			memory(other.memory), begin(other.begin), end(other.end), address(other.address),
+			window_address(other.window_address), window_begin(other.window_begin), current(other.current), window_end(other.window_end)
+		{
+			other.window_begin = nullptr;
+			other.current = nullptr;
+			other.window_end = nullptr;
+		}
+
+		memory_byte_writer(const memory_byte_writer &) = delete;
+		memory_byte_writer & operator =(const memory_byte_writer &) = delete;
+		memory_byte_writer & operator =(memory_byte_writer &&) = delete;
+
+		~memory_byte_writer()
+		{
+			this->flush();
+		}
+
+		// Bytes written so far
+		size_type size() const
+		{
+			return (this->get_position() - this->begin);
+		}
+
+		bool has_bytes_available(std::size_t amount) const
+		{
+			return (amount <= (this->end - this->get_position()));
+		}
+
+		void write_byte(byte value)
+		{
+			if(this->current == this->window_end)
+				this->advance();
+
+			*this->current = value;
+			++this->current;
+		}
+
+		void write_word_big_endian(word value)
+		{
+			if((this->window_end - this->current) < 2)
+			{
+				this->write_byte(static_cast<byte>((value >> 8) & 0xFF));
+				this->write_byte(static_cast<byte>((value >> 0) & 0xFF));
+				return;
+			}
+
+			this->current[0] = static_cast<byte>((value >> 8) & 0xFF);
+			this->current[1] = static_cast<byte>((value >> 0) & 0xFF);
+			this->current += 2;
+		}
+
+		void write_word_little_endian(word value)
+		{
+			this->write_byte(static_cast<byte>((value >> 0) & 0xFF));
+			this->write_byte(static_cast<byte>((value >> 8) & 0xFF));
+		}
+
+		void write_bytes(const byte * values, std::size_t count)
+		{
+			while(count > 0)
+			{
+				if(this->current == this->window_end)
+					this->advance();
+
+				const std::size_t amount = std::min(count, static_cast<std::size_t>(this->window_end - this->current));
+				this->current = std::copy(values, values + amount, this->current);
+
+				values += amount;
+				count -= amount;
+			}
+		}
+
+		// Brings the memory hash and generations up to date with what has been written
+		void flush()
+		{
+			if(this->window_begin == nullptr)
+				return;
+
+			const size_type written = static_cast<size_type>(this->current - this->window_begin);
+			this->memory->close_window(this->window_address, static_cast<size_type>(this->window_end - this->window_begin));
+
+			this->window_address += written;
+			this->address = this->window_address;
+			this->window_begin = nullptr;
+			this->current = nullptr;
+			this->window_end = nullptr;
+		}
+
+	private:
+		size_type get_position() const
+		{
+			return (this->window_address + static_cast<size_type>(this->current - this->window_begin));
+		}
+
+		void advance()
+		{
+			this->flush();
+
+			if(this->address >= this->end)
+				throw std::length_error("memory byte writer is full");
+
+			const size_type page_remaining = (memory_type::page_size - (this->address % memory_type::page_size));
+			const size_type length = std::min(page_remaining, (this->end - this->address));
+
+			this->window_address = this->address;
+			this->window_begin = this->memory->open_window(this->address, length);
+			this->current = this->window_begin;
+			this->window_end = (this->window_begin + length);
+		}
+	};
+
+	template< std::size_t capacity_value, std::size_t page_size_value >
+	void swap(paged_memory<capacity_value, page_size_value> & left, paged_memory<capacity_value, page_size_value> & right) noexcept
+	{
+		left.swap(right);
+	}
+}
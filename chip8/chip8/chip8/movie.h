@@ -0,0 +1,290 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+#include <memory>
+#include <functional>
+#include <istream>
+#include <ostream>
+#include <stdexcept>
+
+#include "base_types.h"
+#include "keys.h"
+#include "keyboard.h"
+#include "headless_display.h"
+
+namespace chip8
+{
+	class movie_format_exception : public std::runtime_error
+	{
+	public:
+		movie_format_exception(const char * message) :
+			std::runtime_error(message)
+		{
+		}
+	};
+
+	using key_state = word;
+
+	constexpr key_state to_key_mask(key_id key)
+	{
+		return static_cast<key_state>(1u << static_cast<unsigned>(key));
+	}
+
+	struct input_event
+	{
+		// The number of instructions the processor had executed when it observed the change
+		std::uint64_t instruction_count;
+		key_state keys;
+	};
+
+	struct input_movie
+	{
+		std::uint64_t random_seed = 0;
+		std::vector<input_event> events;
+	};
+
+	namespace movie_helpers
+	{
+		constexpr byte signature[] { 'C', '8', 'M', 'V' };
+		constexpr word version = 1;
+
+		template< typename Integer >
+		void write_little_endian(std::ostream & output, Integer value)
+		{
+			for(std::size_t index = 0; index < sizeof(Integer); ++index)
+				output.put(static_cast<char>((value >> (index * 8)) & 0xFF));
+		}
+
+		template< typename Integer >
+		Integer read_little_endian(std::istream & input)
+		{
+			Integer value = 0;
+
+			for(std::size_t index = 0; index < sizeof(Integer); ++index)
+			{
+				const auto next = input.get();
+
+				if(next == std::istream::traits_type::eof())
+					throw movie_format_exception("movie is truncated");
+
+				value |= (static_cast<Integer>(static_cast<byte>(next)) << (index * 8));
+			}
+
+			return value;
+		}
+	}
+
+	inline void write_movie(std::ostream & output, const input_movie & movie)
+	{
+		using namespace movie_helpers;
+
+		for(const byte value : signature)
+			output.put(static_cast<char>(value));
+
+		write_little_endian<word>(output, version);
+		write_little_endian<std::uint64_t>(output, movie.random_seed);
+		write_little_endian<std::uint64_t>(output, movie.events.size());
+
+		for(const auto & event : movie.events)
+		{
+			write_little_endian<std::uint64_t>(output, event.instruction_count);
+			write_little_endian<key_state>(output, event.keys);
+		}
+	}
+
+	inline input_movie read_movie(std::istream & input)
+	{
+		using namespace movie_helpers;
+
+		for(const byte value : signature)
+			if(read_little_endian<byte>(input) != value)
+				throw movie_format_exception("movie has an unrecognised signature");
+
+		if(read_little_endian<word>(input) != version)
+			throw movie_format_exception("movie has an unsupported version");
+
+		input_movie movie;
+		movie.random_seed = read_little_endian<std::uint64_t>(input);
+
+		const auto event_count = read_little_endian<std::uint64_t>(input);
+		for(std::uint64_t index = 0; index < event_count; ++index)
+		{
+			const auto instruction_count = read_little_endian<std::uint64_t>(input);
+			const auto keys = read_little_endian<key_state>(input);
+
+			if(!movie.events.empty() && instruction_count < movie.events.back().instruction_count)
+				throw movie_format_exception("movie events are out of order");
+
+			movie.events.push_back(input_event { instruction_count, keys });
+		}
+
+		return movie;
+	}
+
+	// When the processor is rewound with load_state, its instruction count goes back with it,
+	// and the movie keyboards follow it back, so rewinding and run-ahead keep movies exact
+	class movie_keyboard : public keyboard
+	{
+	public:
+		using instruction_clock = std::function<std::uint64_t()>;
+
+	protected:
+		instruction_clock clock;
+		key_state keys = 0;
+
+	public:
+		~movie_keyboard() override = default;
+
+		// Movies are timed by the instruction count of the processor reading the keyboard
+		template< typename Processor >
+		void attach(const Processor & processor)
+		{
+			this->clock = [&processor]() { return processor.get_instruction_count(); };
+		}
+
+		bool is_pressed(key_id key) const override
+		{
+			return ((this->keys & to_key_mask(key)) != 0);
+		}
+
+	protected:
+		std::uint64_t get_instruction_count() const
+		{
+			if(!this->clock)
+				throw std::logic_error("movie keyboard is not attached to a processor");
+
+			return this->clock();
+		}
+	};
+
+	class recording_keyboard : public movie_keyboard
+	{
+	private:
+		std::shared_ptr<keyboard> source;
+		input_movie movie;
+
+	public:
+		recording_keyboard(std::shared_ptr<keyboard> source) :
+			source(std::move(source))
+		{
+		}
+
+		recording_keyboard(std::shared_ptr<keyboard> source, std::uint64_t random_seed) :
+			source(std::move(source))
+		{
+			this->movie.random_seed = random_seed;
+		}
+
+		~recording_keyboard() override = default;
+
+		const input_movie & get_movie() const
+		{
+			return this->movie;
+		}
+
+		void update() override
+		{
+			this->source->update();
+
+			key_state next_keys = 0;
+			for(unsigned key = 0; key < 16; ++key)
+				if(this->source->is_pressed(static_cast<key_id>(key)))
+					next_keys |= to_key_mask(static_cast<key_id>(key));
+
+			const auto instruction_count = this->get_instruction_count();
+
+			// Changes seen after this point belong to a timeline that was abandoned, such as a run-ahead frame
+			if(!this->movie.events.empty() && this->movie.events.back().instruction_count > instruction_count)
+				this->discard_events_after(instruction_count);
+
+			if(next_keys != this->keys)
+			{
+				this->movie.events.push_back(input_event { instruction_count, next_keys });
+				this->keys = next_keys;
+			}
+		}
+
+	private:
+		void discard_events_after(std::uint64_t instruction_count)
+		{
+			auto & events = this->movie.events;
+
+			while(!events.empty() && events.back().instruction_count > instruction_count)
+				events.pop_back();
+
+			this->keys = events.empty() ? 0 : events.back().keys;
+		}
+	};
+
+	class replay_keyboard : public movie_keyboard
+	{
+	private:
+		input_movie movie;
+		std::size_t next_event = 0;
+		std::uint64_t last_instruction_count = 0;
+
+	public:
+		replay_keyboard(input_movie movie) :
+			movie(std::move(movie))
+		{
+		}
+
+		~replay_keyboard() override = default;
+
+		const input_movie & get_movie() const
+		{
+			return this->movie;
+		}
+
+		bool is_finished() const
+		{
+			return (this->next_event == this->movie.events.size());
+		}
+
+		void update() override
+		{
+			const auto instruction_count = this->get_instruction_count();
+
+			// Replays from the start after a rewind, which leaves the keys as they were at that point
+			if(instruction_count < this->last_instruction_count)
+			{
+				this->next_event = 0;
+				this->keys = 0;
+			}
+
+			this->last_instruction_count = instruction_count;
+
+			while(this->next_event < this->movie.events.size() && this->movie.events[this->next_event].instruction_count <= instruction_count)
+			{
+				this->keys = this->movie.events[this->next_event].keys;
+				++this->next_event;
+			}
+		}
+	};
+
+	// Replays a movie headless from power-on, frame by frame as run_ahead and main do, and checks
+	// that it reaches the state the recording processor was in after the same number of frames
+	template< typename Processor, typename InputIterator >
+	bool verify_replay(const input_movie & movie, InputIterator program_begin, InputIterator program_end, std::size_t cycles_per_frame, std::size_t frame_count, std::uint64_t expected_state_hash)
+	{
+		auto keyboard = std::make_shared<replay_keyboard>(movie);
+
+		Processor processor(std::make_shared<headless_display>(), keyboard);
+		keyboard->attach(processor);
+
+		processor.seed_random(movie.random_seed);
+		processor.load_default_sprite_rom();
+		processor.load_program(program_begin, program_end);
+		processor.start();
+
+		for(std::size_t frame = 0; frame < frame_count; ++frame)
+		{
+			processor.run_cycles(cycles_per_frame);
+			processor.update_timers();
+		}
+
+		return (processor.get_state_hash() == expected_state_hash);
+	}
+}
\ No newline at end of file
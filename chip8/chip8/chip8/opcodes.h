@@ -41,5 +41,29 @@ namespace chip8
 		store_registers_i_register,
 		load_registers_i_register,
 		exit,
+
+		// SUPER-CHIP
+		scroll_down_immediate,
+		scroll_right,
+		scroll_left,
+		low_resolution,
+		high_resolution,
+		load_big_digit_sprite_register,
+		store_flags_register,
+		load_flags_register,
+
+		// XO-CHIP
+		scroll_up_immediate,
+		store_registers_range,
+		load_registers_range,
+		load_i_long,
+		select_planes_immediate,
+	};
+
+	enum class instruction_set : byte
+	{
+		chip8,
+		super_chip,
+		xo_chip,
 	};
 }
\ No newline at end of file
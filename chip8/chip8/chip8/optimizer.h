@@ -0,0 +1,693 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#include "base_types.h"
+#include "opcodes.h"
+#include "instructions.h"
+#include "instruction_decoder.h"
+#include "instruction_encoder.h"
+
+namespace chip8
+{
+	// Rewrites a program image so that it runs fewer instructions and takes less space:
+	// jumps to jumps are threaded, jumps to the next instruction and to exits are folded,
+	// constant loads and adds are propagated, and stores that are never read are removed,
+	// as is code that cannot be reached. Jump and call targets are fixed up as code moves.
+	//
+	// Only programs that are pure code are rewritten. Anything that may read the image as data,
+	// or jump through a computed address, makes optimise return false and leave the program as it was.
+	// Buffers are kept between runs, so once they have grown, optimising does not allocate.
+	class peephole_optimizer
+	{
+	public:
+		using size_type = std::size_t;
+		using register_mask = std::uint16_t;
+
+	public:
+		static constexpr size_type max_iterations = 8;
+
+		static bool is_skip(opcode_id opcode)
+		{
+			switch(opcode)
+			{
+			case opcode_id::skip_if_equal_register_immediate:
+			case opcode_id::skip_if_not_equal_register_immediate:
+			case opcode_id::skip_if_equal_register_register:
+			case opcode_id::skip_if_not_equal_register_register:
+			case opcode_id::skip_if_key_pressed_register:
+			case opcode_id::skip_if_key_not_pressed_register:
+				return true;
+			default:
+				return false;
+			}
+		}
+
+	private:
+		static constexpr size_type no_target = static_cast<size_type>(-1);
+		static constexpr register_mask all_registers = 0xFFFF;
+
+		struct ir_instruction
+		{
+			word value;
+			opcode_id opcode;
+
+			// Index of the instruction a jump or call lands on, or no_target if it leaves the program
+			size_type target;
+
+			bool removed;
+		};
+
+	private:
+		pointer origin = 0x200;
+		instruction_set set = instruction_set::chip8;
+
+		std::vector<ir_instruction> instructions;
+		std::vector<size_type> new_indices;
+		std::vector<register_mask> live_out;
+		std::vector<bool> flags;
+		std::vector<size_type> worklist;
+
+	public:
+		bool optimize(std::vector<byte> & program, pointer origin = 0x200, instruction_set set = instruction_set::chip8)
+		{
+			this->origin = origin;
+			this->set = set;
+
+			if(!this->decode(program))
+				return false;
+
+			for(size_type iteration = 0; iteration < max_iterations; ++iteration)
+			{
+				bool changed = false;
+
+				changed |= this->thread_jumps();
+				this->compact();
+
+				changed |= this->propagate_constants();
+				this->compact();
+
+				changed |= this->eliminate_dead_stores();
+				this->compact();
+
+				changed |= this->remove_unreachable();
+				this->compact();
+
+				if(!changed)
+					break;
+			}
+
+			this->encode(program);
+			return true;
+		}
+
+	private:
+		static size_type get_x(word value)
+		{
+			return ((value >> 8) & 0x0F);
+		}
+
+		static size_type get_y(word value)
+		{
+			return ((value >> 4) & 0x0F);
+		}
+
+		static byte get_immediate(word value)
+		{
+			return static_cast<byte>((value >> 0) & 0xFF);
+		}
+
+		static register_mask get_mask(size_type index)
+		{
+			return static_cast<register_mask>(1u << index);
+		}
+
+		// V0 through VX, as read or written by FX55 and FX65
+		static register_mask get_range_mask(size_type last)
+		{
+			return static_cast<register_mask>((2u << last) - 1);
+		}
+
+		// Nothing runs after these by falling through
+		static bool ends_path(opcode_id opcode)
+		{
+			switch(opcode)
+			{
+			case opcode_id::jump_address:
+			case opcode_id::function_return:
+			case opcode_id::exit:
+				return true;
+			default:
+				return false;
+			}
+		}
+
+		static register_mask get_uses(const ir_instruction & instruction)
+		{
+			const word value = instruction.value;
+			const register_mask x = get_mask(get_x(value));
+			const register_mask y = get_mask(get_y(value));
+
+			switch(instruction.opcode)
+			{
+			case opcode_id::clear_screen:
+			case opcode_id::jump_address:
+			case opcode_id::load_register_immediate:
+			case opcode_id::load_i_immediate:
+			case opcode_id::random_register_immediate:
+			case opcode_id::read_delay_timer_register:
+			case opcode_id::await_key_press_register:
+			case opcode_id::load_registers_i_register:
+			case opcode_id::load_flags_register:
+				return 0;
+
+			case opcode_id::load_register_register:
+				return y;
+
+			case opcode_id::skip_if_equal_register_immediate:
+			case opcode_id::skip_if_not_equal_register_immediate:
+			case opcode_id::add_register_immediate:
+			case opcode_id::skip_if_key_pressed_register:
+			case opcode_id::skip_if_key_not_pressed_register:
+			case opcode_id::write_delay_timer_register:
+			case opcode_id::write_sound_timer_register:
+			case opcode_id::add_i_register:
+			case opcode_id::load_digit_sprite_register:
+			case opcode_id::load_big_digit_sprite_register:
+			case opcode_id::load_bcd_register:
+				return x;
+
+			// Shifts read VX or VY depending on the quirks in use, so both count
+			case opcode_id::skip_if_equal_register_register:
+			case opcode_id::skip_if_not_equal_register_register:
+			case opcode_id::or_register_register:
+			case opcode_id::and_register_register:
+			case opcode_id::xor_register_register:
+			case opcode_id::add_register_register:
+			case opcode_id::subtract_register_register:
+			case opcode_id::shift_right_register_register:
+			case opcode_id::reverse_subtract_register_register:
+			case opcode_id::shift_left_register_register:
+			case opcode_id::draw_x_y_size:
+				return (x | y);
+
+			case opcode_id::store_registers_i_register:
+			case opcode_id::store_flags_register:
+				return get_range_mask(get_x(value));
+
+			// Calls, returns, exits and anything less common are assumed to read every register
+			default:
+				return all_registers;
+			}
+		}
+
+		// Registers the instruction always overwrites
+		static register_mask get_definite_writes(const ir_instruction & instruction)
+		{
+			const word value = instruction.value;
+			const register_mask x = get_mask(get_x(value));
+			const register_mask flag = get_mask(0xF);
+
+			switch(instruction.opcode)
+			{
+			case opcode_id::load_register_immediate:
+			case opcode_id::add_register_immediate:
+			case opcode_id::load_register_register:
+			case opcode_id::or_register_register:
+			case opcode_id::and_register_register:
+			case opcode_id::xor_register_register:
+			case opcode_id::random_register_immediate:
+			case opcode_id::read_delay_timer_register:
+			case opcode_id::await_key_press_register:
+				return x;
+
+			case opcode_id::add_register_register:
+			case opcode_id::subtract_register_register:
+			case opcode_id::shift_right_register_register:
+			case opcode_id::reverse_subtract_register_register:
+			case opcode_id::shift_left_register_register:
+				return (x | flag);
+
+			case opcode_id::draw_x_y_size:
+				return flag;
+
+			case opcode_id::load_registers_i_register:
+			case opcode_id::load_flags_register:
+				return get_range_mask(get_x(value));
+
+			default:
+				return 0;
+			}
+		}
+
+		// Registers the instruction might overwrite
+		static register_mask get_possible_writes(const ir_instruction & instruction)
+		{
+			switch(instruction.opcode)
+			{
+			// VF is cleared by the logical operations under some quirks
+			case opcode_id::or_register_register:
+			case opcode_id::and_register_register:
+			case opcode_id::xor_register_register:
+				return (get_definite_writes(instruction) | get_mask(0xF));
+
+			// The callee may write anything, and XO-CHIP 5XY3 writes a range that may run either way
+			case opcode_id::call_address:
+			case opcode_id::load_registers_range:
+				return all_registers;
+
+			default:
+				return get_definite_writes(instruction);
+			}
+		}
+
+		// Instructions whose only effect is on registers, so they may go once those registers are dead.
+		// CXNN is not among them, as removing it would change the random sequence.
+		static bool is_register_only(opcode_id opcode)
+		{
+			switch(opcode)
+			{
+			case opcode_id::load_register_immediate:
+			case opcode_id::add_register_immediate:
+			case opcode_id::load_register_register:
+			case opcode_id::or_register_register:
+			case opcode_id::and_register_register:
+			case opcode_id::xor_register_register:
+			case opcode_id::add_register_register:
+			case opcode_id::subtract_register_register:
+			case opcode_id::shift_right_register_register:
+			case opcode_id::reverse_subtract_register_register:
+			case opcode_id::shift_left_register_register:
+			case opcode_id::read_delay_timer_register:
+				return true;
+			default:
+				return false;
+			}
+		}
+
+		bool contains(pointer address, size_type size) const
+		{
+			return (address >= this->origin) && (static_cast<size_type>(address - this->origin) < size);
+		}
+
+		bool decode(const std::vector<byte> & program)
+		{
+			this->instructions.clear();
+
+			if((program.size() % 2) != 0)
+				return false;
+
+			for(size_type offset = 0; offset < program.size(); offset += 2)
+			{
+				const word value = static_cast<word>((program[offset + 0] << 8) | (program[offset + 1] << 0));
+
+				tagged_instruction instruction { opcode_id::clear_screen };
+				if(!try_decode(value, this->set, instruction))
+					return false;
+
+				const opcode_id opcode = instruction.get_opcode();
+				size_type target = no_target;
+
+				switch(opcode)
+				{
+				// Would move data, or jump to where the data the program computes on has moved
+				case opcode_id::load_i_long:
+				case opcode_id::jump_address_register_0:
+					return false;
+
+				case opcode_id::load_i_immediate:
+					if(this->contains(instruction.get_address(), program.size()))
+						return false;
+					break;
+
+				case opcode_id::jump_address:
+				case opcode_id::call_address:
+					if(this->contains(instruction.get_address(), program.size()))
+					{
+						const size_type target_offset = (instruction.get_address() - this->origin);
+
+						// A target inside an instruction would be read as a different instruction
+						if((target_offset % 2) != 0)
+							return false;
+
+						target = (target_offset / 2);
+					}
+					break;
+
+				default:
+					break;
+				}
+
+				this->instructions.push_back(ir_instruction { value, opcode, target, false });
+			}
+
+			return true;
+		}
+
+		void encode(std::vector<byte> & program) const
+		{
+			program.resize(this->instructions.size() * 2);
+
+			for(size_type index = 0; index < this->instructions.size(); ++index)
+			{
+				const ir_instruction & instruction = this->instructions[index];
+				word value = instruction.value;
+
+				if(instruction.target != no_target)
+					value = encoding::address(static_cast<byte>(value >> 12), static_cast<pointer>(this->origin + (instruction.target * 2)));
+
+				program[(index * 2) + 0] = static_cast<byte>((value >> 8) & 0xFF);
+				program[(index * 2) + 1] = static_cast<byte>((value >> 0) & 0xFF);
+			}
+		}
+
+		// The instruction would no longer be the one skipped if its size changed
+		bool is_shadowed(size_type index) const
+		{
+			return (index > 0) && is_skip(this->instructions[index - 1].opcode);
+		}
+
+		void remove(size_type index)
+		{
+			this->instructions[index].removed = true;
+		}
+
+		void replace(size_type index, word value)
+		{
+			ir_instruction & instruction = this->instructions[index];
+
+			tagged_instruction decoded { opcode_id::clear_screen };
+			static_cast<void>(try_decode(value, this->set, decoded));
+
+			instruction.value = value;
+			instruction.opcode = decoded.get_opcode();
+			instruction.target = no_target;
+		}
+
+		// Drops removed instructions, moving anything that landed on one to the instruction after it
+		void compact()
+		{
+			const size_type count = this->instructions.size();
+			this->new_indices.resize(count);
+
+			size_type kept = 0;
+			for(size_type index = 0; index < count; ++index)
+			{
+				this->new_indices[index] = kept;
+
+				if(!this->instructions[index].removed)
+					++kept;
+			}
+
+			if(kept == count)
+				return;
+
+			size_type next = 0;
+			for(size_type index = 0; index < count; ++index)
+			{
+				ir_instruction instruction = this->instructions[index];
+
+				if(instruction.removed)
+					continue;
+
+				if(instruction.target != no_target)
+					instruction.target = this->new_indices[instruction.target];
+
+				this->instructions[next] = instruction;
+				++next;
+			}
+
+			this->instructions.resize(kept);
+		}
+
+		bool thread_jumps()
+		{
+			bool changed = false;
+			const size_type count = this->instructions.size();
+
+			for(size_type index = 0; index < count; ++index)
+			{
+				ir_instruction & instruction = this->instructions[index];
+
+				if(instruction.opcode != opcode_id::jump_address && instruction.opcode != opcode_id::call_address)
+					continue;
+
+				if(instruction.target == no_target)
+					continue;
+
+				// Bounded, as jumps may form a loop
+				size_type target = instruction.target;
+				for(size_type step = 0; step < count; ++step)
+				{
+					const ir_instruction & destination = this->instructions[target];
+
+					if(destination.opcode != opcode_id::jump_address || destination.target == no_target || destination.target == target)
+						break;
+
+					target = destination.target;
+				}
+
+				if(target != instruction.target)
+				{
+					instruction.target = target;
+					changed = true;
+				}
+
+				if(instruction.opcode != opcode_id::jump_address)
+					continue;
+
+				const opcode_id destination = this->instructions[target].opcode;
+
+				if(destination == opcode_id::exit || destination == opcode_id::function_return)
+				{
+					this->replace(index, this->instructions[target].value);
+					changed = true;
+				}
+				else if(target == (index + 1) && !this->is_shadowed(index))
+				{
+					this->remove(index);
+					changed = true;
+				}
+			}
+
+			return changed;
+		}
+
+		// Follows register values that are known constants through straight-line code
+		bool propagate_constants()
+		{
+			bool changed = false;
+			const size_type count = this->instructions.size();
+
+			this->flags.assign(count, false);
+			for(const auto & instruction : this->instructions)
+				if(instruction.target != no_target)
+					this->flags[instruction.target] = true;
+
+			register_mask known = 0;
+			byte values[16] {};
+
+			for(size_type index = 0; index < count; ++index)
+			{
+				// Other paths join here
+				if(this->flags[index])
+					known = 0;
+
+				const word value = this->instructions[index].value;
+				const size_type x = get_x(value);
+				const size_type y = get_y(value);
+				const bool is_last = ((index + 1) == count);
+
+				switch(this->instructions[index].opcode)
+				{
+				case opcode_id::load_register_immediate:
+					if((known & get_mask(x)) != 0 && values[x] == get_immediate(value) && !this->is_shadowed(index) && !is_last)
+					{
+						this->remove(index);
+						changed = true;
+					}
+					break;
+
+				case opcode_id::add_register_immediate:
+					if((known & get_mask(x)) != 0)
+					{
+						this->replace(index, encoding::special(0x6, static_cast<register_id>(x), static_cast<byte>(values[x] + get_immediate(value))));
+						changed = true;
+					}
+					break;
+
+				case opcode_id::load_register_register:
+					if((known & get_mask(y)) == 0)
+						break;
+
+					if((known & get_mask(x)) != 0 && values[x] == values[y] && !this->is_shadowed(index) && !is_last)
+					{
+						this->remove(index);
+						changed = true;
+					}
+					else
+					{
+						this->replace(index, encoding::special(0x6, static_cast<register_id>(x), values[y]));
+						changed = true;
+					}
+					break;
+
+				default:
+					break;
+				}
+
+				const ir_instruction & instruction = this->instructions[index];
+
+				if(instruction.removed)
+					continue;
+
+				known &= static_cast<register_mask>(~get_possible_writes(instruction));
+
+				if(instruction.opcode == opcode_id::load_register_immediate)
+				{
+					values[get_x(instruction.value)] = get_immediate(instruction.value);
+
+					// What was skipped may or may not have run, so it leaves nothing known
+					if(!this->is_shadowed(index))
+						known |= get_mask(get_x(instruction.value));
+				}
+
+				if(ends_path(instruction.opcode) || instruction.opcode == opcode_id::call_address)
+					known = 0;
+			}
+
+			return changed;
+		}
+
+		void find_live_registers()
+		{
+			const size_type count = this->instructions.size();
+			this->live_out.assign(count, 0);
+
+			const auto get_live_in = [this](size_type index) -> register_mask
+			{
+				if(index >= this->instructions.size())
+					return all_registers;
+
+				const ir_instruction & instruction = this->instructions[index];
+				return static_cast<register_mask>(get_uses(instruction) | (this->live_out[index] & ~get_definite_writes(instruction)));
+			};
+
+			for(bool changed = true; changed;)
+			{
+				changed = false;
+
+				for(size_type index = count; index-- > 0;)
+				{
+					const ir_instruction & instruction = this->instructions[index];
+					register_mask live = 0;
+
+					switch(instruction.opcode)
+					{
+					// Registers are part of the state left behind
+					case opcode_id::exit:
+					case opcode_id::function_return:
+						live = all_registers;
+						break;
+
+					case opcode_id::jump_address:
+						live = (instruction.target != no_target) ? get_live_in(instruction.target) : all_registers;
+						break;
+
+					case opcode_id::call_address:
+						live = all_registers;
+						break;
+
+					default:
+						live = get_live_in(index + 1);
+
+						if(is_skip(instruction.opcode))
+							live |= get_live_in(index + 2);
+						break;
+					}
+
+					if(live != this->live_out[index])
+					{
+						this->live_out[index] = live;
+						changed = true;
+					}
+				}
+			}
+		}
+
+		bool eliminate_dead_stores()
+		{
+			bool changed = false;
+			const size_type count = this->instructions.size();
+
+			this->find_live_registers();
+
+			for(size_type index = 0; (index + 1) < count; ++index)
+			{
+				const ir_instruction & instruction = this->instructions[index];
+
+				if(!is_register_only(instruction.opcode) || this->is_shadowed(index))
+					continue;
+
+				if((get_possible_writes(instruction) & this->live_out[index]) == 0)
+				{
+					this->remove(index);
+					changed = true;
+				}
+			}
+
+			return changed;
+		}
+
+		bool remove_unreachable()
+		{
+			const size_type count = this->instructions.size();
+
+			this->flags.assign(count, false);
+			this->worklist.clear();
+
+			const auto reach = [this, count](size_type index)
+			{
+				if(index < count && !this->flags[index])
+				{
+					this->flags[index] = true;
+					this->worklist.push_back(index);
+				}
+			};
+
+			reach(0);
+
+			while(!this->worklist.empty())
+			{
+				const size_type index = this->worklist.back();
+				this->worklist.pop_back();
+
+				const ir_instruction & instruction = this->instructions[index];
+
+				if(instruction.target != no_target)
+					reach(instruction.target);
+
+				if(!ends_path(instruction.opcode))
+					reach(index + 1);
+
+				if(is_skip(instruction.opcode))
+					reach(index + 2);
+			}
+
+			bool changed = false;
+
+			for(size_type index = 0; index < count; ++index)
+			{
+				if(!this->flags[index])
+				{
+					this->remove(index);
+					changed = true;
+				}
+			}
+
+			return changed;
+		}
+	};
+}
\ No newline at end of file
@@ -0,0 +1,151 @@
+#pragma once
+
+// Needs C++20 coroutines, so the header is empty for older language versions
+#if defined(__cpp_impl_coroutine)
+
+#include <cstddef>
+#include <coroutine>
+#include <exception>
+#include <utility>
+
+#include "processor.h"
+
+namespace chip8
+{
+	// A suspended processor run. Each resume continues exactly where the last event was yielded
+	class processor_task
+	{
+	public:
+		struct promise_type
+		{
+			processor_event event = processor_event::frame;
+			std::exception_ptr exception;
+
+			processor_task get_return_object()
+			{
+				return processor_task(std::coroutine_handle<promise_type>::from_promise(*this));
+			}
+
+			std::suspend_always initial_suspend() noexcept
+			{
+				return {};
+			}
+
+			std::suspend_always final_suspend() noexcept
+			{
+				return {};
+			}
+
+			std::suspend_always yield_value(processor_event event) noexcept
+			{
+				this->event = event;
+				return {};
+			}
+
+			void return_void()
+			{
+				this->event = processor_event::halt;
+			}
+
+			void unhandled_exception()
+			{
+				this->exception = std::current_exception();
+			}
+		};
+
+	private:
+		using handle_type = std::coroutine_handle<promise_type>;
+
+	private:
+		handle_type handle;
+
+	private:
+		explicit processor_task(handle_type handle) :
+			handle(handle)
+		{
+		}
+
+	public:
+		processor_task(const processor_task & other) = delete;
+
+		processor_task(processor_task && other) noexcept :
+			handle(std::exchange(other.handle, nullptr))
+		{
+		}
+
+		processor_task & operator =(const processor_task & other) = delete;
+
+		processor_task & operator =(processor_task && other) noexcept
+		{
+			if(this != &other)
+			{
+				if(this->handle)
+					this->handle.destroy();
+
+				this->handle = std::exchange(other.handle, nullptr);
+			}
+			return *this;
+		}
+
+		~processor_task()
+		{
+			if(this->handle)
+				this->handle.destroy();
+		}
+
+		bool is_done() const
+		{
+			return (!this->handle || this->handle.done());
+		}
+
+		processor_event get_event() const
+		{
+			return this->handle.promise().event;
+		}
+
+		// Runs until the next event, returning false once the processor has halted
+		bool resume()
+		{
+			if(this->is_done())
+				return false;
+
+			this->handle.resume();
+
+			if(this->handle.promise().exception)
+				std::rethrow_exception(this->handle.promise().exception);
+
+			return !this->handle.done();
+		}
+	};
+
+	// Yields draw and key_wait events as they happen and frame at the end of every frame,
+	// timers are updated once per frame.
+	// The processor must outlive the task
+	template< typename Processor >
+	processor_task run_processor(Processor & processor, std::size_t cycles_per_frame)
+	{
+		while(processor.get_state() != processor_state::halted)
+		{
+			std::size_t remaining = cycles_per_frame;
+
+			while(remaining > 0)
+			{
+				const auto result = processor.run_until_event(remaining);
+				remaining -= result.cycle_count;
+
+				if(result.event == processor_event::halt)
+					co_return;
+
+				if(result.event == processor_event::frame)
+					break;
+
+				co_yield result.event;
+			}
+
+			processor.update_timers();
+			co_yield processor_event::frame;
+		}
+	}
+}
+
+#endif
\ No newline at end of file
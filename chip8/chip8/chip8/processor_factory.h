@@ -0,0 +1,185 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <utility>
+#include <stdexcept>
+
+#include "base_types.h"
+#include "display.h"
+#include "keyboard.h"
+#include "quirks.h"
+#include "processor.h"
+
+namespace chip8
+{
+	// Dispatches per batch of cycles rather than per instruction,
+	// so each instantiation keeps its specialised inner loop
+	class processor_interface
+	{
+	public:
+		using display_pointer = std::shared_ptr<display>;
+		using keyboard_pointer = std::shared_ptr<keyboard>;
+
+	public:
+		virtual ~processor_interface() = default;
+
+		virtual processor_state get_state() const = 0;
+
+		virtual void reset() = 0;
+
+		virtual void start() = 0;
+
+		virtual void stop() = 0;
+
+		virtual void pause() = 0;
+
+		virtual void resume() = 0;
+
+		virtual void run(std::size_t cycle_count) = 0;
+
+		virtual void run_cycles(std::size_t cycle_count) = 0;
+
+		virtual void update_timers() = 0;
+
+		virtual void update_display() = 0;
+
+		virtual void seed_random(std::uint64_t seed) = 0;
+
+		virtual void load_default_sprite_rom() = 0;
+
+		virtual void load_program(const byte * begin, const byte * end) = 0;
+
+		virtual std::uint64_t get_instruction_count() const = 0;
+	};
+
+	template< typename Processor >
+	class processor_adapter : public processor_interface
+	{
+	public:
+		using processor_type = Processor;
+
+	private:
+		processor_type processor;
+
+	public:
+		template< typename ... Args >
+		processor_adapter(Args && ... args) :
+			processor(std::forward<Args>(args)...)
+		{
+		}
+
+		~processor_adapter() override = default;
+
+		processor_type & get_processor()
+		{
+			return this->processor;
+		}
+
+		const processor_type & get_processor() const
+		{
+			return this->processor;
+		}
+
+		processor_state get_state() const override
+		{
+			return this->processor.get_state();
+		}
+
+		void reset() override
+		{
+			this->processor.reset();
+		}
+
+		void start() override
+		{
+			this->processor.start();
+		}
+
+		void stop() override
+		{
+			this->processor.stop();
+		}
+
+		void pause() override
+		{
+			this->processor.pause();
+		}
+
+		void resume() override
+		{
+			this->processor.resume();
+		}
+
+		void run(std::size_t cycle_count) override
+		{
+			this->processor.run(cycle_count);
+		}
+
+		void run_cycles(std::size_t cycle_count) override
+		{
+			this->processor.run_cycles(cycle_count);
+		}
+
+		void update_timers() override
+		{
+			this->processor.update_timers();
+		}
+
+		void update_display() override
+		{
+			this->processor.update_display();
+		}
+
+		void seed_random(std::uint64_t seed) override
+		{
+			this->processor.seed_random(seed);
+		}
+
+		void load_default_sprite_rom() override
+		{
+			this->processor.load_default_sprite_rom();
+		}
+
+		void load_program(const byte * begin, const byte * end) override
+		{
+			this->processor.load_program(begin, end);
+		}
+
+		std::uint64_t get_instruction_count() const override
+		{
+			return this->processor.get_instruction_count();
+		}
+	};
+
+	template< typename Quirks >
+	std::unique_ptr<processor_interface> make_processor(processor_interface::display_pointer display, processor_interface::keyboard_pointer keyboard)
+	{
+		return std::make_unique<processor_adapter<quirks_processor<Quirks>>>(std::move(display), std::move(keyboard));
+	}
+
+	inline std::unique_ptr<processor_interface> make_processor(quirks_id quirks, processor_interface::display_pointer display, processor_interface::keyboard_pointer keyboard)
+	{
+		switch(quirks)
+		{
+		case quirks_id::default_quirks:
+			return make_processor<default_quirks>(std::move(display), std::move(keyboard));
+
+		case quirks_id::cosmac_vip:
+			return make_processor<cosmac_vip_quirks>(std::move(display), std::move(keyboard));
+
+		case quirks_id::chip48:
+			return make_processor<chip48_quirks>(std::move(display), std::move(keyboard));
+
+		case quirks_id::super_chip:
+			return make_processor<super_chip_quirks>(std::move(display), std::move(keyboard));
+
+		case quirks_id::xo_chip:
+			return make_processor<xo_chip_quirks>(std::move(display), std::move(keyboard));
+
+		default:
+			throw std::invalid_argument("unknown quirks profile");
+		}
+	}
+}
\ No newline at end of file
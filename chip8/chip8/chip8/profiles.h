@@ -0,0 +1,49 @@
+#pragma once
+
+#include <cstddef>
+
+#include "opcodes.h"
+
+namespace chip8
+{
+	// Each profile is instantiated separately,
+	// so the plain CHIP-8 processor keeps its 4 KB memory and 256 byte display
+
+	struct chip8_profile
+	{
+		static constexpr instruction_set instructions = instruction_set::chip8;
+
+		static constexpr std::size_t memory_size = 0x1000;
+		static constexpr std::size_t stack_size = 16;
+
+		static constexpr std::size_t display_width = 64;
+		static constexpr std::size_t display_height = 32;
+		static constexpr std::size_t display_planes = 1;
+	};
+
+	// 128x64 high resolution mode, scrolling, 16x16 sprites, a large font and persistent flags
+	struct super_chip_profile
+	{
+		static constexpr instruction_set instructions = instruction_set::super_chip;
+
+		static constexpr std::size_t memory_size = 0x1000;
+		static constexpr std::size_t stack_size = 16;
+
+		static constexpr std::size_t display_width = 128;
+		static constexpr std::size_t display_height = 64;
+		static constexpr std::size_t display_planes = 1;
+	};
+
+	// SUPER-CHIP plus 64 KB of memory, F000 NNNN, register ranges and two bitplanes
+	struct xo_chip_profile
+	{
+		static constexpr instruction_set instructions = instruction_set::xo_chip;
+
+		static constexpr std::size_t memory_size = 0x10000;
+		static constexpr std::size_t stack_size = 16;
+
+		static constexpr std::size_t display_width = 128;
+		static constexpr std::size_t display_height = 64;
+		static constexpr std::size_t display_planes = 2;
+	};
+}
\ No newline at end of file
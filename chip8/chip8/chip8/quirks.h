@@ -0,0 +1,94 @@
+#pragma once
+
+#include <string>
+#include <stdexcept>
+
+namespace chip8
+{
+	// Each flag selects between two interpretations that real ROMs depend on.
+	// Flags are constant expressions, so every quirk profile compiles
+	// into its own interpreter with the untaken interpretation removed.
+
+	struct default_quirks
+	{
+		// 8XY6/8XYE shift VY into VX, rather than shifting VX in place
+		static constexpr bool shift_uses_vy = true;
+
+		// FX55/FX65 leave I pointing past the last register transferred
+		static constexpr bool load_store_increments_i = false;
+
+		// BNNN jumps to NNN + VX rather than NNN + V0
+		static constexpr bool jump_uses_vx = false;
+
+		// 8XY1/8XY2/8XY3 reset VF to zero
+		static constexpr bool logic_resets_vf = false;
+
+		// Sprites drawn past the edge of the screen wrap around, rather than being clipped
+		static constexpr bool draw_wraps = true;
+	};
+
+	struct cosmac_vip_quirks
+	{
+		static constexpr bool shift_uses_vy = true;
+		static constexpr bool load_store_increments_i = true;
+		static constexpr bool jump_uses_vx = false;
+		static constexpr bool logic_resets_vf = true;
+		static constexpr bool draw_wraps = false;
+	};
+
+	struct chip48_quirks
+	{
+		static constexpr bool shift_uses_vy = false;
+		static constexpr bool load_store_increments_i = true;
+		static constexpr bool jump_uses_vx = true;
+		static constexpr bool logic_resets_vf = false;
+		static constexpr bool draw_wraps = false;
+	};
+
+	struct super_chip_quirks
+	{
+		static constexpr bool shift_uses_vy = false;
+		static constexpr bool load_store_increments_i = false;
+		static constexpr bool jump_uses_vx = true;
+		static constexpr bool logic_resets_vf = false;
+		static constexpr bool draw_wraps = false;
+	};
+
+	struct xo_chip_quirks
+	{
+		static constexpr bool shift_uses_vy = true;
+		static constexpr bool load_store_increments_i = true;
+		static constexpr bool jump_uses_vx = false;
+		static constexpr bool logic_resets_vf = false;
+		static constexpr bool draw_wraps = true;
+	};
+
+	enum class quirks_id
+	{
+		default_quirks,
+		cosmac_vip,
+		chip48,
+		super_chip,
+		xo_chip,
+	};
+
+	inline quirks_id parse_quirks_id(const std::string & name)
+	{
+		if(name == "default")
+			return quirks_id::default_quirks;
+
+		if(name == "vip" || name == "cosmac_vip")
+			return quirks_id::cosmac_vip;
+
+		if(name == "chip48")
+			return quirks_id::chip48;
+
+		if(name == "schip" || name == "super_chip")
+			return quirks_id::super_chip;
+
+		if(name == "xochip" || name == "xo_chip")
+			return quirks_id::xo_chip;
+
+		throw std::invalid_argument("unknown quirks profile");
+	}
+}
\ No newline at end of file
@@ -0,0 +1,190 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+#include "base_types.h"
+
+namespace chip8
+{
+	inline std::uint64_t splitmix64(std::uint64_t & state)
+	{
+		state += 0x9E3779B97F4A7C15u;
+
+		std::uint64_t result = state;
+		result = ((result ^ (result >> 30)) * 0xBF58476D1CE4E5B9u);
+		result = ((result ^ (result >> 27)) * 0x94D049BB133111EBu);
+		return (result ^ (result >> 31));
+	}
+
+	// xoshiro128** by David Blackman and Sebastiano Vigna
+	class xoshiro128_star_star
+	{
+	public:
+		using result_type = std::uint32_t;
+
+	public:
+		static constexpr std::size_t state_size = (4 * sizeof(std::uint32_t));
+
+	private:
+		std::uint32_t state[4] {};
+
+	public:
+		xoshiro128_star_star()
+		{
+			this->seed(0);
+		}
+
+		explicit xoshiro128_star_star(std::uint64_t seed_value)
+		{
+			this->seed(seed_value);
+		}
+
+		static constexpr result_type min()
+		{
+			return 0;
+		}
+
+		static constexpr result_type max()
+		{
+			return UINT32_MAX;
+		}
+
+		void seed(std::uint64_t seed_value)
+		{
+			std::uint64_t mixer = seed_value;
+
+			const std::uint64_t low = splitmix64(mixer);
+			const std::uint64_t high = splitmix64(mixer);
+
+			this->state[0] = static_cast<std::uint32_t>(low >> 0);
+			this->state[1] = static_cast<std::uint32_t>(low >> 32);
+			this->state[2] = static_cast<std::uint32_t>(high >> 0);
+			this->state[3] = static_cast<std::uint32_t>(high >> 32);
+		}
+
+		// Gives each of many instances sharing one seed its own reproducible stream
+		void seed(std::uint64_t seed_value, std::uint64_t stream)
+		{
+			std::uint64_t mixer = stream;
+			this->seed(seed_value ^ splitmix64(mixer));
+		}
+
+		result_type operator()()
+		{
+			const std::uint32_t result = (rotate_left(this->state[1] * 5, 7) * 9);
+			const std::uint32_t shifted = (this->state[1] << 9);
+
+			this->state[2] ^= this->state[0];
+			this->state[3] ^= this->state[1];
+			this->state[1] ^= this->state[2];
+			this->state[0] ^= this->state[3];
+
+			this->state[2] ^= shifted;
+
+			this->state[3] = rotate_left(this->state[3], 11);
+
+			return result;
+		}
+
+		byte next_byte()
+		{
+			return static_cast<byte>((*this)() >> 24);
+		}
+
+		// Fills a block four bytes per step for engines that consume randomness in bulk
+		void generate(byte * begin, byte * end)
+		{
+			while((end - begin) >= 4)
+			{
+				const result_type value = (*this)();
+
+				begin[0] = static_cast<byte>(value >> 24);
+				begin[1] = static_cast<byte>(value >> 16);
+				begin[2] = static_cast<byte>(value >> 8);
+				begin[3] = static_cast<byte>(value >> 0);
+				begin += 4;
+			}
+
+			if(begin != end)
+			{
+				const result_type value = (*this)();
+
+				for(std::size_t shift = 24; begin != end; shift -= 8, ++begin)
+					*begin = static_cast<byte>(value >> shift);
+			}
+		}
+
+		// Advances by 2^64 steps, returning a generator for the skipped-over stream
+		xoshiro128_star_star split()
+		{
+			xoshiro128_star_star result = *this;
+			this->jump();
+			return result;
+		}
+
+		void jump()
+		{
+			static constexpr std::uint32_t jump_table[] { 0x8764000B, 0xF542D2D3, 0x6FA035C3, 0x77F2DB5B };
+
+			std::uint32_t next[4] {};
+
+			for(const std::uint32_t jump_value : jump_table)
+				for(std::size_t bit = 0; bit < 32; ++bit)
+				{
+					if((jump_value & (UINT32_C(1) << bit)) != 0)
+						for(std::size_t index = 0; index < 4; ++index)
+							next[index] ^= this->state[index];
+
+					static_cast<void>((*this)());
+				}
+
+			for(std::size_t index = 0; index < 4; ++index)
+				this->state[index] = next[index];
+		}
+
+		void save(byte * output) const
+		{
+			for(std::size_t index = 0; index < 4; ++index)
+				for(std::size_t shift = 0; shift < 32; shift += 8)
+				{
+					*output = static_cast<byte>(this->state[index] >> shift);
+					++output;
+				}
+		}
+
+		void load(const byte * input)
+		{
+			for(std::size_t index = 0; index < 4; ++index)
+			{
+				this->state[index] = 0;
+
+				for(std::size_t shift = 0; shift < 32; shift += 8)
+				{
+					this->state[index] |= (static_cast<std::uint32_t>(*input) << shift);
+					++input;
+				}
+			}
+		}
+
+		bool operator ==(const xoshiro128_star_star & other) const
+		{
+			for(std::size_t index = 0; index < 4; ++index)
+				if(this->state[index] != other.state[index])
+					return false;
+
+			return true;
+		}
+
+		bool operator !=(const xoshiro128_star_star & other) const
+		{
+			return !(*this == other);
+		}
+
+	private:
+		static constexpr std::uint32_t rotate_left(std::uint32_t value, unsigned shift)
+		{
+			return ((value << shift) | (value >> (32 - shift)));
+		}
+	};
+}
\ No newline at end of file
@@ -38,7 +38,7 @@ namespace chip8
 		using size_type = typename array_type::size_type;
 
 	private:
-		array_type registers;
+		array_type registers {};
 
 	public:
 		byte & at(size_type index)
@@ -0,0 +1,262 @@
+#pragma once
+
+#include <cstddef>
+#include <cstring>
+#include <vector>
+#include <deque>
+#include <memory>
+#include <stdexcept>
+
+#include "base_types.h"
+
+namespace chip8
+{
+	namespace rewind_helpers
+	{
+		inline void write_length(std::vector<byte> & output, std::size_t value)
+		{
+			while(value >= 0x80)
+			{
+				output.push_back(static_cast<byte>((value & 0x7F) | 0x80));
+				value >>= 7;
+			}
+			output.push_back(static_cast<byte>(value));
+		}
+
+		inline std::size_t read_length(const byte * & input, const byte * end)
+		{
+			std::size_t value = 0;
+
+			for(std::size_t shift = 0; input != end; shift += 7)
+			{
+				const byte next = *input;
+				++input;
+
+				value |= (static_cast<std::size_t>(next & 0x7F) << shift);
+
+				if((next & 0x80) == 0)
+					return value;
+			}
+
+			throw std::length_error("rewind entry is truncated");
+		}
+
+		// Encodes (current ^ reference) as alternating runs of
+		// [zero count][literal count][literal bytes...]
+		inline void encode_delta(std::vector<byte> & output, const byte * current, const byte * reference, std::size_t size)
+		{
+			output.clear();
+
+			const auto get_difference = [current, reference](std::size_t index)
+			{
+				return (reference != nullptr) ? static_cast<byte>(current[index] ^ reference[index]) : current[index];
+			};
+
+			std::size_t index = 0;
+			while(index < size)
+			{
+				const std::size_t zero_begin = index;
+				while(index < size && get_difference(index) == 0)
+					++index;
+
+				const std::size_t literal_begin = index;
+				while(index < size && get_difference(index) != 0)
+					++index;
+
+				write_length(output, literal_begin - zero_begin);
+				write_length(output, index - literal_begin);
+
+				for(std::size_t literal = literal_begin; literal < index; ++literal)
+					output.push_back(get_difference(literal));
+			}
+		}
+
+		// Applies an encoded delta on top of output, which must already hold the reference
+		inline void decode_delta(byte * output, std::size_t size, const std::vector<byte> & delta)
+		{
+			const byte * input = delta.data();
+			const byte * end = (input + delta.size());
+
+			std::size_t index = 0;
+			while(input != end)
+			{
+				index += read_length(input, end);
+				const std::size_t literal_count = read_length(input, end);
+
+				if(index > size || literal_count > (size - index) || literal_count > static_cast<std::size_t>(end - input))
+					throw std::length_error("rewind entry does not fit the state image");
+
+				for(std::size_t literal = 0; literal < literal_count; ++literal, ++index, ++input)
+					output[index] ^= *input;
+			}
+		}
+	}
+
+	template< typename Processor >
+	class rewind_buffer
+	{
+	public:
+		using processor_type = Processor;
+		using state_image_type = typename processor_type::state_image_type;
+		using size_type = std::size_t;
+
+	public:
+		static constexpr size_type default_capacity = (4 * 1024 * 1024);
+		static constexpr size_type default_keyframe_interval = 60;
+
+	private:
+		struct entry
+		{
+			bool is_keyframe;
+			std::vector<byte> data;
+		};
+
+	private:
+		std::deque<entry> entries;
+		size_type capacity;
+		size_type keyframe_interval;
+		size_type used_bytes = 0;
+		size_type frames_since_keyframe = 0;
+		bool has_keyframe = false;
+
+		std::unique_ptr<state_image_type> keyframe = std::make_unique<state_image_type>();
+		std::unique_ptr<state_image_type> current = std::make_unique<state_image_type>();
+		std::vector<byte> encode_buffer;
+
+	public:
+		rewind_buffer() :
+			rewind_buffer(default_capacity, default_keyframe_interval)
+		{
+		}
+
+		rewind_buffer(size_type capacity, size_type keyframe_interval) :
+			capacity(capacity), keyframe_interval(keyframe_interval)
+		{
+			if(keyframe_interval == 0)
+				throw std::invalid_argument("keyframe interval must be greater than zero");
+
+			this->encode_buffer.reserve(sizeof(state_image_type));
+		}
+
+		size_type size() const
+		{
+			return this->entries.size();
+		}
+
+		bool empty() const
+		{
+			return this->entries.empty();
+		}
+
+		size_type get_used_bytes() const
+		{
+			return this->used_bytes;
+		}
+
+		size_type get_capacity() const
+		{
+			return this->capacity;
+		}
+
+		void clear()
+		{
+			this->entries.clear();
+			this->used_bytes = 0;
+			this->frames_since_keyframe = 0;
+			this->has_keyframe = false;
+		}
+
+		void capture(const processor_type & processor)
+		{
+			const bool is_keyframe = (!this->has_keyframe || this->frames_since_keyframe >= this->keyframe_interval);
+
+			if(is_keyframe)
+			{
+				processor.save_state(*this->keyframe);
+				rewind_helpers::encode_delta(this->encode_buffer, as_bytes(*this->keyframe), nullptr, sizeof(state_image_type));
+
+				this->has_keyframe = true;
+				this->frames_since_keyframe = 0;
+			}
+			else
+			{
+				processor.save_state(*this->current);
+				rewind_helpers::encode_delta(this->encode_buffer, as_bytes(*this->current), as_bytes(*this->keyframe), sizeof(state_image_type));
+			}
+
+			++this->frames_since_keyframe;
+
+			this->entries.push_back(entry { is_keyframe, std::vector<byte>(std::begin(this->encode_buffer), std::end(this->encode_buffer)) });
+			this->used_bytes += this->encode_buffer.size();
+
+			this->evict();
+		}
+
+		bool rewind(processor_type & processor)
+		{
+			if(this->entries.empty())
+				return false;
+
+			auto keyframe_iterator = std::prev(std::end(this->entries));
+			while(!keyframe_iterator->is_keyframe)
+				--keyframe_iterator;
+
+			std::memset(as_bytes(*this->keyframe), 0, sizeof(state_image_type));
+			rewind_helpers::decode_delta(as_bytes(*this->keyframe), sizeof(state_image_type), keyframe_iterator->data);
+
+			const auto & newest = this->entries.back();
+
+			if(newest.is_keyframe)
+			{
+				processor.load_state(*this->keyframe);
+			}
+			else
+			{
+				std::memcpy(as_bytes(*this->current), as_bytes(*this->keyframe), sizeof(state_image_type));
+				rewind_helpers::decode_delta(as_bytes(*this->current), sizeof(state_image_type), newest.data);
+				processor.load_state(*this->current);
+			}
+
+			const bool was_keyframe = newest.is_keyframe;
+			const auto remaining_group_size = static_cast<size_type>(std::distance(keyframe_iterator, std::end(this->entries)) - 1);
+
+			this->used_bytes -= newest.data.size();
+			this->entries.pop_back();
+
+			this->has_keyframe = !was_keyframe;
+			this->frames_since_keyframe = was_keyframe ? 0 : remaining_group_size;
+
+			return true;
+		}
+
+	private:
+		static byte * as_bytes(state_image_type & image)
+		{
+			return reinterpret_cast<byte *>(&image);
+		}
+
+		static const byte * as_bytes(const state_image_type & image)
+		{
+			return reinterpret_cast<const byte *>(&image);
+		}
+
+		// Deltas depend on their keyframe, so whole groups are evicted at once
+		void evict()
+		{
+			while(this->used_bytes > this->capacity)
+			{
+				auto group_end = std::next(std::begin(this->entries));
+				while(group_end != std::end(this->entries) && !group_end->is_keyframe)
+					++group_end;
+
+				if(group_end == std::end(this->entries))
+					return;
+
+				for(auto iterator = std::begin(this->entries); iterator != group_end; ++iterator)
+					this->used_bytes -= iterator->data.size();
+
+				this->entries.erase(std::begin(this->entries), group_end);
+			}
+		}
+	};
+}
\ No newline at end of file
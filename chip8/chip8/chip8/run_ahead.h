@@ -0,0 +1,66 @@
+#pragma once
+
+#include <cstddef>
+#include <memory>
+
+namespace chip8
+{
+	// Hides input latency by presenting a frame that is frame_count frames in the future,
+	// then restoring the processor to the real present before the next host frame
+	template< typename Processor >
+	class run_ahead
+	{
+	public:
+		using processor_type = Processor;
+		using state_image_type = typename processor_type::state_image_type;
+		using size_type = std::size_t;
+
+	private:
+		processor_type & processor;
+		size_type cycles_per_frame;
+		size_type frame_count;
+		std::unique_ptr<state_image_type> snapshot = std::make_unique<state_image_type>();
+
+	public:
+		run_ahead(processor_type & processor, size_type cycles_per_frame, size_type frame_count) :
+			processor(processor), cycles_per_frame(cycles_per_frame), frame_count(frame_count)
+		{
+		}
+
+		size_type get_frame_count() const
+		{
+			return this->frame_count;
+		}
+
+		void set_frame_count(size_type frame_count)
+		{
+			this->frame_count = frame_count;
+		}
+
+		void run_frame()
+		{
+			this->run_single_frame();
+
+			if(this->frame_count == 0)
+			{
+				this->processor.update_display();
+				return;
+			}
+
+			this->processor.save_state(*this->snapshot);
+
+			for(size_type frame = 0; frame < this->frame_count; ++frame)
+				this->run_single_frame();
+
+			this->processor.update_display();
+			this->processor.load_state(*this->snapshot);
+		}
+
+	private:
+		void run_single_frame()
+		{
+			this->processor.run_cycles(this->cycles_per_frame);
+			this->processor.update_timers();
+		}
+	};
+}
\ No newline at end of file
@@ -0,0 +1,121 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <stdexcept>
+#include <type_traits>
+#include <algorithm>
+#include <iterator>
+
+#include "base_types.h"
+
+namespace chip8
+{
+	class state_format_exception : public std::runtime_error
+	{
+	public:
+		state_format_exception(const char * message) :
+			std::runtime_error(message)
+		{
+		}
+	};
+
+	struct little_endian_word
+	{
+		byte low;
+		byte high;
+
+		word get() const
+		{
+			return static_cast<word>((this->high << 8) | (this->low << 0));
+		}
+
+		void set(word value)
+		{
+			this->low = static_cast<byte>((value >> 0) & 0xFF);
+			this->high = static_cast<byte>((value >> 8) & 0xFF);
+		}
+	};
+
+	struct little_endian_count
+	{
+		byte bytes[8];
+
+		std::uint64_t get() const
+		{
+			std::uint64_t value = 0;
+
+			for(std::size_t index = 0; index < sizeof(this->bytes); ++index)
+				value |= (static_cast<std::uint64_t>(this->bytes[index]) << (index * 8));
+
+			return value;
+		}
+
+		void set(std::uint64_t value)
+		{
+			for(std::size_t index = 0; index < sizeof(this->bytes); ++index)
+				this->bytes[index] = static_cast<byte>((value >> (index * 8)) & 0xFF);
+		}
+	};
+
+	constexpr byte state_image_signature[] { 'C', '8', 'S', 'T' };
+	constexpr word state_image_version = 5;
+
+	// Every field is a byte or an array of bytes,
+	// so the layout has no padding, no alignment requirement and no host byte order,
+	// which means an image can be copied, written to disk or mapped from disk as-is
+	template< std::size_t memory_size, std::size_t display_size, std::size_t stack_size, std::size_t random_state_size >
+	struct basic_state_image
+	{
+		byte signature[4];
+		little_endian_word version;
+
+		// Movies are timed by this count, so it travels with the state,
+		// but it is not part of the machine state that states are compared by
+		little_endian_count instruction_count;
+
+		little_endian_word program_counter;
+		little_endian_word i_register;
+		byte state;
+		byte call_stack_size;
+		byte delay_timer;
+		byte sound_timer;
+		byte high_resolution;
+		byte plane_mask;
+		byte key_register;
+		byte registers[16];
+		byte user_flags[16];
+		little_endian_word call_stack[stack_size];
+		byte random_state[random_state_size];
+
+		byte display[display_size];
+		byte memory[memory_size];
+
+		void set_header()
+		{
+			static_cast<void>(std::copy(std::begin(state_image_signature), std::end(state_image_signature), std::begin(this->signature)));
+			this->version.set(state_image_version);
+		}
+
+		bool has_valid_header() const
+		{
+			return std::equal(std::begin(state_image_signature), std::end(state_image_signature), std::begin(this->signature))
+				&& (this->version.get() == state_image_version);
+		}
+
+		// Compares everything after the instruction count, so states reached at different times can match
+		bool has_same_machine_state(const basic_state_image & other) const
+		{
+			const auto begin = reinterpret_cast<const byte *>(&this->program_counter);
+			const auto end = (reinterpret_cast<const byte *>(this) + sizeof(basic_state_image));
+
+			return std::equal(begin, end, reinterpret_cast<const byte *>(&other.program_counter));
+		}
+	};
+
+	using state_image = basic_state_image<0x1000, 0x100, 16, 16>;
+
+	static_assert(std::is_trivially_copyable<state_image>::value, "state image must be trivially copyable");
+	static_assert(std::is_standard_layout<state_image>::value, "state image must have standard layout");
+	static_assert(sizeof(state_image) == (4 + 2 + 8 + 2 + 2 + 4 + 3 + 16 + 16 + (16 * 2) + 16 + 0x100 + 0x1000), "state image must not contain padding");
+}
\ No newline at end of file
@@ -2,6 +2,8 @@
 
 #include <cstddef>
 #include <array>
+#include <cstdint>
+#include <type_traits>
 #include <exception>
 
 namespace chip8
@@ -45,9 +47,13 @@ namespace chip8
 	public:
 		static constexpr size_type capacity = count;
 
+	private:
+		// Small stacks use a byte counter so the whole stack packs tightly next to other state
+		using counter_type = typename std::conditional<(count <= UINT8_MAX), std::uint8_t, size_type>::type;
+
 	private:
 		array_type items;
-		size_type next = 0;
+		counter_type next = 0;
 
 	public:
 
@@ -88,7 +94,7 @@ namespace chip8
 		void push(value_type && value)
 		{
 			if(this->size() == this->max_size())
-				throw stack_overflow_exception();
+				throw stack_overflow_exception("attempt to push to full stack");
 
 			this->items[this->next] = std::move(value);
 			++this->next;
@@ -98,7 +104,7 @@ namespace chip8
 		void emplace(Args && ... args)
 		{
 			if(this->size() == this->max_size())
-				throw stack_overflow_exception();
+				throw stack_overflow_exception("attempt to push to full stack");
 
 			::new (static_cast<void *>(&this->items[this->next])) T(std::forward<Args>(args)...);
 			++this->next;
@@ -113,8 +119,14 @@ namespace chip8
 			this->items[this->next].~value_type();
 		}
 
+		void clear()
+		{
+			while(!this->empty())
+				this->pop();
+		}
+
 		void swap(stack<T, count> & other)
-			noexcept(noexcept(std::declval<array_type>().swap(std::declval<array_type>())) && noexcept(std::swap(std::declval<size_type &>(), std::declval<size_type>())))
+			noexcept(noexcept(std::declval<array_type>().swap(std::declval<array_type>())) && noexcept(std::swap(std::declval<counter_type &>(), std::declval<counter_type &>())))
 		{
 			this->items.swap(other.items);
 			std::swap(this->next, other.next);
@@ -0,0 +1,50 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+#include "base_types.h"
+
+namespace chip8
+{
+	// State hashes are sums of value * key(position) modulo 2^64,
+	// so changing a single byte updates the hash in constant time
+	namespace state_hash_helpers
+	{
+		constexpr std::uint64_t memory_salt = 0x6D656D6F72790000u;
+		constexpr std::uint64_t display_salt = 0x646973706C617900u;
+		constexpr std::uint64_t core_salt = 0x636F726500000000u;
+
+		inline std::uint64_t mix(std::uint64_t value)
+		{
+			value = ((value ^ (value >> 30)) * 0xBF58476D1CE4E5B9u);
+			value = ((value ^ (value >> 27)) * 0x94D049BB133111EBu);
+			return (value ^ (value >> 31));
+		}
+
+		inline std::uint64_t position_key(std::uint64_t salt, std::size_t position)
+		{
+			return (mix(salt + (position * 0x9E3779B97F4A7C15u)) | 1);
+		}
+
+		inline std::uint64_t update(std::uint64_t hash, std::uint64_t salt, std::size_t position, byte old_value, byte new_value)
+		{
+			return (hash + ((static_cast<std::uint64_t>(new_value) - static_cast<std::uint64_t>(old_value)) * position_key(salt, position)));
+		}
+
+		inline std::uint64_t hash_range(std::uint64_t salt, std::size_t first_position, const byte * begin, const byte * end)
+		{
+			std::uint64_t hash = 0;
+
+			for(std::size_t position = first_position; begin != end; ++begin, ++position)
+				hash += (static_cast<std::uint64_t>(*begin) * position_key(salt, position));
+
+			return hash;
+		}
+
+		inline std::uint64_t combine(std::uint64_t hash, std::uint64_t value)
+		{
+			return mix(hash ^ (value + 0x9E3779B97F4A7C15u + (hash << 6) + (hash >> 2)));
+		}
+	}
+}
\ No newline at end of file
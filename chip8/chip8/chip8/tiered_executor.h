@@ -0,0 +1,268 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+#include <memory>
+#include <algorithm>
+#include <exception>
+
+#include "base_types.h"
+#include "opcodes.h"
+#include "instructions.h"
+#include "instruction_decoder.h"
+#include "processor.h"
+
+namespace chip8
+{
+	namespace tier_helpers
+	{
+		// Instructions after which the next instruction is not necessarily the following word
+		inline bool ends_block(opcode_id opcode)
+		{
+			switch(opcode)
+			{
+			case opcode_id::function_return:
+			case opcode_id::jump_address:
+			case opcode_id::call_address:
+			case opcode_id::skip_if_equal_register_immediate:
+			case opcode_id::skip_if_not_equal_register_immediate:
+			case opcode_id::skip_if_equal_register_register:
+			case opcode_id::skip_if_not_equal_register_register:
+			case opcode_id::jump_address_register_0:
+			case opcode_id::skip_if_key_pressed_register:
+			case opcode_id::skip_if_key_not_pressed_register:
+			case opcode_id::await_key_press_register:
+			case opcode_id::load_i_long:
+			case opcode_id::exit:
+				return true;
+			default:
+				return false;
+			}
+		}
+	}
+
+	struct tier_counters
+	{
+		std::uint64_t block_entries = 0;
+		std::uint64_t interpreted_instructions = 0;
+		std::uint64_t predecoded_instructions = 0;
+		std::uint64_t promotions = 0;
+		std::uint64_t demotions = 0;
+	};
+
+	// Every block starts out interpreted.
+	// Once a block has been entered promotion_threshold times it is decoded once and cached,
+	// and the cached block is dropped again if a write touches the memory it was decoded from
+	template< typename Processor >
+	class tiered_executor
+	{
+	public:
+		using processor_type = Processor;
+		using memory_type = typename processor_type::memory_type;
+		using size_type = std::size_t;
+
+	public:
+		static constexpr size_type default_promotion_threshold = 32;
+		static constexpr size_type max_block_size = 64;
+
+		static_assert((max_block_size * sizeof(word)) <= memory_type::page_size, "a block must not span more than two pages");
+
+	private:
+		struct block
+		{
+			std::vector<tagged_instruction> instructions;
+			size_type first_page;
+			size_type last_page;
+			std::uint32_t first_page_generation;
+			std::uint32_t last_page_generation;
+		};
+
+		using block_pointer = std::unique_ptr<block>;
+
+	private:
+		std::vector<block_pointer> blocks;
+		std::vector<std::uint32_t> hotness;
+		size_type promotion_threshold;
+		tier_counters counters;
+
+	public:
+		tiered_executor() :
+			tiered_executor(default_promotion_threshold)
+		{
+		}
+
+		explicit tiered_executor(size_type promotion_threshold) :
+			blocks(memory_type::capacity), hotness(memory_type::capacity), promotion_threshold(promotion_threshold)
+		{
+		}
+
+		const tier_counters & get_counters() const
+		{
+			return this->counters;
+		}
+
+		size_type get_promotion_threshold() const
+		{
+			return this->promotion_threshold;
+		}
+
+		void set_promotion_threshold(size_type promotion_threshold)
+		{
+			this->promotion_threshold = promotion_threshold;
+		}
+
+		size_type get_block_count() const
+		{
+			return static_cast<size_type>(std::count_if(std::begin(this->blocks), std::end(this->blocks), [](const block_pointer & block) { return (block != nullptr); }));
+		}
+
+		// Required when switching to a processor with different memory contents
+		void clear()
+		{
+			for(auto & block : this->blocks)
+				block.reset();
+
+			std::fill(std::begin(this->hotness), std::end(this->hotness), 0);
+		}
+
+		void run_cycles(processor_type & processor, size_type cycle_count)
+		{
+			size_type remaining = cycle_count;
+
+			while(remaining > 0)
+			{
+				const auto state = processor.get_state();
+
+				if(state == processor_state::halted)
+					return;
+
+				if(state == processor_state::awaiting_key)
+				{
+					processor.run_cycles(1);
+					--remaining;
+					continue;
+				}
+
+				const pointer address = processor.get_program_counter();
+
+				if(address >= processor_type::program_end_offset)
+					return;
+
+				++this->counters.block_entries;
+
+				auto & cached = this->blocks[address];
+
+				if(cached != nullptr && !is_valid(processor, *cached))
+				{
+					cached.reset();
+					this->hotness[address] = 0;
+					++this->counters.demotions;
+				}
+
+				if(cached == nullptr && ++this->hotness[address] >= this->promotion_threshold)
+				{
+					cached = translate(processor, address);
+					this->hotness[address] = 0;
+
+					if(cached != nullptr)
+						++this->counters.promotions;
+				}
+
+				remaining -= (cached != nullptr) ? this->run_block(processor, *cached, remaining) : this->interpret_block(processor, remaining);
+			}
+		}
+
+	private:
+		static bool is_valid(const processor_type & processor, const block & block)
+		{
+			const auto & memory = processor.get_memory();
+
+			return (memory.get_page_generation(block.first_page) == block.first_page_generation)
+				&& (memory.get_page_generation(block.last_page) == block.last_page_generation);
+		}
+
+		static block_pointer translate(const processor_type & processor, pointer address)
+		{
+			const auto & memory = processor.get_memory();
+
+			auto result = std::make_unique<block>();
+
+			std::size_t next = address;
+			while(result->instructions.size() < max_block_size && (next + 1) < processor_type::program_end_offset)
+			{
+				const word value = static_cast<word>((memory.read(next) << 8) | (memory.read(next + 1) << 0));
+
+				// Undecodable words are left to the interpreter, which reports them
+				try
+				{
+					result->instructions.push_back(decode(value, processor_type::profile_type::instructions));
+				}
+				catch(const std::exception &)
+				{
+					break;
+				}
+
+				next += sizeof(word);
+
+				if(tier_helpers::ends_block(result->instructions.back().get_opcode()))
+					break;
+			}
+
+			if(result->instructions.empty())
+				return nullptr;
+
+			result->first_page = (address / memory_type::page_size);
+			result->last_page = ((next - 1) / memory_type::page_size);
+			result->first_page_generation = memory.get_page_generation(result->first_page);
+			result->last_page_generation = memory.get_page_generation(result->last_page);
+
+			return result;
+		}
+
+		size_type run_block(processor_type & processor, const block & block, size_type budget)
+		{
+			const auto generation = processor.get_memory().get_generation();
+
+			size_type executed = 0;
+			for(const auto & instruction : block.instructions)
+			{
+				if(executed == budget)
+					break;
+
+				processor.execute_decoded(instruction);
+				++executed;
+
+				// A block that rewrites itself must not keep running its stale decoding
+				if(processor.get_memory().get_generation() != generation && !is_valid(processor, block))
+					break;
+			}
+
+			this->counters.predecoded_instructions += executed;
+			return executed;
+		}
+
+		size_type interpret_block(processor_type & processor, size_type budget)
+		{
+			size_type executed = 0;
+			while(executed < budget)
+			{
+				const pointer previous = processor.get_program_counter();
+
+				processor.run_cycles(1);
+				++executed;
+
+				const auto state = processor.get_state();
+
+				if(state == processor_state::halted || state == processor_state::awaiting_key)
+					break;
+
+				if(processor.get_program_counter() != static_cast<pointer>(previous + sizeof(word)))
+					break;
+			}
+
+			this->counters.interpreted_instructions += executed;
+			return executed;
+		}
+	};
+}
\ No newline at end of file
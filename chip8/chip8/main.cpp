@@ -1,3 +1,5 @@
+#include <random>
+
 #include <SDL.h>
 
 #include "chip8.h"
@@ -13,7 +15,7 @@ std::vector<chip8::byte> create_program_b()
 	label label_a;
 
 	return
-		program(),
+		program(optimization::peephole),
 		reg_0 = 0x00,
 		reg_1 = 0x00,
 		reg_2 = 0x00,
@@ -97,6 +99,7 @@ int main(int argument_count, char * arguments[])
 
 	chip8::processor processor(std::static_pointer_cast<chip8::display>(display), std::static_pointer_cast<chip8::keyboard>(keyboard));
 
+	processor.seed_random(std::random_device()());
 	processor.load_default_sprite_rom();
 
 	//const auto program_a = create_program_a();
@@ -107,6 +110,12 @@ int main(int argument_count, char * arguments[])
 
 	processor.start();
 
+	constexpr std::size_t cycles_per_frame = 64;
+	constexpr std::size_t run_ahead_frames = 1;
+
+	chip8::rewind_buffer<chip8::processor> rewind_buffer;
+	chip8::run_ahead<chip8::processor> run_ahead(processor, cycles_per_frame, run_ahead_frames);
+
 	bool running = true;
 	while(running)
 	{
@@ -121,11 +130,22 @@ int main(int argument_count, char * arguments[])
 			}
 		}
 
-		//processor.reset();
-		processor.run(64);
+		const Uint8 * keyboard_state = SDL_GetKeyboardState(nullptr);
+
+		if(keyboard_state[SDL_Scancode::SDL_SCANCODE_BACKSPACE] != 0)
+		{
+			if(rewind_buffer.rewind(processor))
+				processor.update_display();
+		}
+		else
+		{
+			//processor.reset();
+			run_ahead.run_frame();
+
+			rewind_buffer.capture(processor);
+		}
 
 		//SDL_RenderClear(renderer.get());
-		processor.update_display();
 	}
 
 	return EXIT_SUCCESS;
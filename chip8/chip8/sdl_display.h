@@ -5,8 +5,12 @@
 #include "chip8.h"
 #include "sdl_shared.h"
 
-class sdl_display : public chip8::display
+template< typename DisplayBuffer >
+class basic_sdl_display : public chip8::basic_display<DisplayBuffer>
 {
+public:
+	using display_buffer = DisplayBuffer;
+
 private:
 	sdl_renderer_pointer renderer;
 	int x;
@@ -15,19 +19,25 @@ private:
 	int pixel_height;
 
 public:
-	sdl_display(sdl_renderer_pointer renderer, int x, int y, int pixel_width, int pixel_height) :
+	basic_sdl_display(sdl_renderer_pointer renderer, int x, int y, int pixel_width, int pixel_height) :
 		renderer(renderer), x(x), y(y), pixel_width(pixel_width), pixel_height(pixel_height)
 	{
 	}
 
-	~sdl_display() override = default;
+	~basic_sdl_display() override = default;
 
 	void update(const display_buffer & buffer) override
 	{
 		using size_type = typename display_buffer::size_type;
 
-		constexpr SDL_Colour black { 0x00, 0x00, 0x00, SDL_ALPHA_OPAQUE };
-		constexpr SDL_Colour white { 0xFF, 0xFF, 0xFF, SDL_ALPHA_OPAQUE };
+		// Indexed by the combined plane bits of each pixel
+		constexpr SDL_Colour palette[]
+		{
+			{ 0x00, 0x00, 0x00, SDL_ALPHA_OPAQUE },
+			{ 0xFF, 0xFF, 0xFF, SDL_ALPHA_OPAQUE },
+			{ 0xAA, 0xAA, 0xAA, SDL_ALPHA_OPAQUE },
+			{ 0x55, 0x55, 0x55, SDL_ALPHA_OPAQUE },
+		};
 
 		for(size_type y = 0; y < buffer.get_height(); ++y)
 		{
@@ -39,7 +49,7 @@ public:
 
 				SDL_Rect rect { draw_x * this->pixel_width, draw_y * this->pixel_height, this->pixel_width, this->pixel_height };
 				
-				auto colour = buffer.test(x, y) ? white : black;
+				const auto & colour = palette[buffer.get_pixel(x, y) % 4];
 
 				SDL_SetRenderDrawColor(this->renderer.get(), colour.r, colour.g, colour.b, colour.a);
 				SDL_RenderFillRect(this->renderer.get(), &rect);
@@ -51,4 +61,6 @@ public:
 	{
 		SDL_RenderPresent(this->renderer.get());
 	}
-};
\ No newline at end of file
+};
+
+using sdl_display = basic_sdl_display<chip8::display::display_buffer>;
\ No newline at end of file
@@ -0,0 +1,917 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+#include <algorithm>
+#include <stdexcept>
+
+#include "chip8/base_types.h"
+#include "chip8/registers.h"
+#include "chip8/instruction_encoder.h"
+
+#include "lexer.h"
+#include "symbol_table.h"
+#include "object_file.h"
+
+namespace chip8
+{
+	namespace assembler
+	{
+		class assembly_exception : public std::runtime_error
+		{
+		private:
+			std::size_t line;
+
+		public:
+			assembly_exception(const char * message, std::size_t line) :
+				std::runtime_error(message), line(line)
+			{
+			}
+
+			std::size_t get_line() const
+			{
+				return this->line;
+			}
+		};
+
+		enum class fixup_kind : std::uint8_t
+		{
+			// The low 12 bits of an instruction
+			address,
+
+			// The low byte of an instruction
+			immediate,
+
+			// The low 4 bits of an instruction
+			nibble,
+
+			// A whole big-endian word
+			word,
+
+			// A single data byte
+			data_byte,
+		};
+
+		struct fixup
+		{
+			std::size_t offset;
+			symbol_table::index_type symbol;
+			std::int32_t addend;
+			fixup_kind kind;
+			std::size_t line;
+			std::uint32_t section;
+		};
+
+		enum class mnemonic
+		{
+			cls, ret, exit, scd, scu, scr, scl, low, high,
+			jp, call, se, sne, ld, add, or_, and_, xor_, sub, shr, subn, shl,
+			rnd, drw, skp, sknp, plane, save, load,
+			db, dw,
+			global, section,
+			unknown,
+		};
+
+		// Two passes: the first lexes, encodes and records a fixup for every forward reference,
+		// the second patches each fixup once every label is known.
+		// When assembling an object, labels are offsets into their section instead of addresses,
+		// so every use of one becomes a relocation and every undefined symbol becomes an import
+		class source_assembler
+		{
+		public:
+			using encoder_type = chip8::basic_encoder<vector_byte_writer>;
+			using container_type = vector_byte_writer::container_type;
+
+		public:
+			static constexpr pointer program_offset = 0x200;
+
+		private:
+			static constexpr symbol_table::index_type no_symbol = UINT32_MAX;
+			static constexpr std::uint32_t no_section = UINT32_MAX;
+
+			struct expression
+			{
+				std::int32_t value;
+				symbol_table::index_type symbol;
+
+				// The section the value is an offset into, when it is a relocatable label
+				std::uint32_t section;
+
+				bool is_resolved() const
+				{
+					return (this->symbol == no_symbol);
+				}
+
+				bool is_relocatable() const
+				{
+					return (this->section != no_section);
+				}
+			};
+
+			enum class operand_type
+			{
+				none,
+				value,
+				long_value,
+				v_register,
+				i_register,
+				indirect_i,
+				delay_timer,
+				sound_timer,
+				key,
+				font,
+				big_font,
+				bcd,
+				flags,
+			};
+
+			struct operand
+			{
+				operand_type type;
+				register_id reg;
+				expression value;
+			};
+
+		private:
+			vector_byte_writer writer;
+
+			// Labels hold absolute addresses, so the encoder adds no offset of its own
+			encoder_type encoder { writer, 0 };
+
+			symbol_table symbols;
+			std::vector<fixup> fixups;
+
+			// Only used when assembling an object
+			bool is_object = false;
+			object_module object;
+			std::uint32_t section_index = 0;
+			std::vector<symbol_table::index_type> exports;
+			std::vector<std::uint32_t> object_symbols;
+
+			lexer * source = nullptr;
+			token current {};
+
+		public:
+			const container_type & assemble(const char * begin, const char * end)
+			{
+				this->is_object = false;
+				this->parse(begin, end);
+				this->apply_fixups();
+
+				return this->writer.get_container();
+			}
+
+			// Sources start in the code section, and may switch with the section directive
+			const object_module & assemble_object(const char * begin, const char * end)
+			{
+				this->is_object = true;
+				this->object.clear();
+				this->object.sections.push_back(object_section { "code", {} });
+
+				this->parse(begin, end);
+
+				// The current section's bytes are still in the writer
+				std::swap(this->writer.get_container(), this->object.sections[this->section_index].bytes);
+
+				this->export_symbols();
+				this->apply_fixups();
+
+				std::sort(this->object.relocations.begin(), this->object.relocations.end(), [](const relocation & left, const relocation & right)
+				{
+					return (left.section != right.section) ? (left.section < right.section) : (left.offset < right.offset);
+				});
+
+				return this->object;
+			}
+
+			const container_type & get_program() const
+			{
+				return this->writer.get_container();
+			}
+
+			const object_module & get_object() const
+			{
+				return this->object;
+			}
+
+			const symbol_table & get_symbols() const
+			{
+				return this->symbols;
+			}
+
+		private:
+			void parse(const char * begin, const char * end)
+			{
+				this->writer.get_container().clear();
+				this->symbols.clear();
+				this->fixups.clear();
+				this->exports.clear();
+				this->section_index = 0;
+
+				// Generated sources average a little over one instruction per dozen characters
+				this->writer.get_container().reserve(static_cast<std::size_t>(end - begin) / 6);
+
+				lexer lexer(begin, end);
+				this->source = &lexer;
+				this->advance();
+
+				while(!this->current.is(token_type::end))
+					this->parse_line();
+
+				this->source = nullptr;
+			}
+
+			void advance()
+			{
+				this->current = this->source->next();
+			}
+
+			[[noreturn]] void fail(const char * message) const
+			{
+				throw assembly_exception(message, this->source->get_line());
+			}
+
+			void expect(token_type type, const char * message)
+			{
+				if(!this->current.is(type))
+					this->fail(message);
+
+				this->advance();
+			}
+
+			std::size_t get_offset() const
+			{
+				return this->writer.get_container().size();
+			}
+
+			void parse_line()
+			{
+				if(this->current.is(token_type::identifier))
+				{
+					const token name = this->current;
+					this->advance();
+
+					if(this->current.is(token_type::colon))
+					{
+						this->advance();
+						this->define(name, symbol_kind::label, static_cast<std::int32_t>((this->is_object ? 0 : program_offset) + this->get_offset()));
+
+						// A label may share its line with an instruction
+						if(this->current.is(token_type::identifier))
+						{
+							const token instruction = this->current;
+							this->advance();
+							this->parse_instruction(get_mnemonic(instruction));
+						}
+					}
+					else if(this->current.is(token_type::equals) || this->current.is_keyword("equ"))
+					{
+						this->advance();
+
+						const expression value = this->parse_expression();
+
+						if(!value.is_resolved())
+							this->fail("constant depends on a symbol that is not yet defined");
+
+						if(value.is_relocatable())
+							this->fail("constant depends on a relocatable label");
+
+						this->define(name, symbol_kind::constant, value.value);
+					}
+					else
+					{
+						this->parse_instruction(get_mnemonic(name));
+					}
+				}
+
+				if(this->current.is(token_type::end))
+					return;
+
+				this->expect(token_type::end_of_line, "unexpected token at end of line");
+			}
+
+			void define(const token & name, symbol_kind kind, std::int32_t value)
+			{
+				symbol & entry = this->symbols[this->symbols.intern(name.text, name.length, this->source->get_line())];
+
+				if(entry.is_defined())
+					this->fail("symbol is already defined");
+
+				entry.kind = kind;
+				entry.value = static_cast<std::uint32_t>(value);
+				entry.line = this->source->get_line();
+				entry.section = this->section_index;
+			}
+
+			static mnemonic get_mnemonic(const token & name)
+			{
+				static constexpr struct
+				{
+					const char * name;
+					mnemonic value;
+				}
+				mnemonics[]
+				{
+					{ "ld", mnemonic::ld }, { "add", mnemonic::add }, { "drw", mnemonic::drw }, { "se", mnemonic::se },
+					{ "sne", mnemonic::sne }, { "jp", mnemonic::jp }, { "call", mnemonic::call }, { "ret", mnemonic::ret },
+					{ "cls", mnemonic::cls }, { "rnd", mnemonic::rnd }, { "skp", mnemonic::skp }, { "sknp", mnemonic::sknp },
+					{ "or", mnemonic::or_ }, { "and", mnemonic::and_ }, { "xor", mnemonic::xor_ }, { "sub", mnemonic::sub },
+					{ "subn", mnemonic::subn }, { "shr", mnemonic::shr }, { "shl", mnemonic::shl }, { "exit", mnemonic::exit },
+					{ "scd", mnemonic::scd }, { "scu", mnemonic::scu }, { "scr", mnemonic::scr }, { "scl", mnemonic::scl },
+					{ "low", mnemonic::low }, { "high", mnemonic::high }, { "plane", mnemonic::plane }, { "save", mnemonic::save },
+					{ "load", mnemonic::load }, { "db", mnemonic::db }, { "dw", mnemonic::dw }, { "global", mnemonic::global },
+					{ "section", mnemonic::section },
+				};
+
+				for(const auto & entry : mnemonics)
+					if(name.is_keyword(entry.name))
+						return entry.value;
+
+				return mnemonic::unknown;
+			}
+
+			expression parse_term()
+			{
+				if(this->current.is(token_type::number))
+				{
+					const auto value = static_cast<std::int32_t>(this->current.value);
+					this->advance();
+					return expression { value, no_symbol, no_section };
+				}
+
+				if(this->current.is(token_type::identifier))
+				{
+					const auto index = this->symbols.intern(this->current.text, this->current.length, this->source->get_line());
+					this->advance();
+
+					const symbol & entry = this->symbols[index];
+
+					if(entry.is_defined())
+					{
+						const bool is_relocatable = (this->is_object && entry.kind == symbol_kind::label);
+						return expression { static_cast<std::int32_t>(entry.value), no_symbol, is_relocatable ? entry.section : no_section };
+					}
+
+					return expression { 0, index, no_section };
+				}
+
+				this->fail("expected a number or symbol");
+			}
+
+			// Sums and differences of terms, at most one of which may be a forward reference
+			// or a relocatable label, though two labels from the same section may be subtracted
+			expression parse_expression()
+			{
+				const bool negate = this->current.is(token_type::minus);
+
+				if(negate)
+					this->advance();
+
+				expression result = this->parse_term();
+
+				if(negate)
+				{
+					if(!result.is_resolved())
+						this->fail("a forward reference cannot be negated");
+
+					if(result.is_relocatable())
+						this->fail("a relocatable label cannot be negated");
+
+					result.value = -result.value;
+				}
+
+				while(this->current.is(token_type::plus) || this->current.is(token_type::minus))
+				{
+					const bool subtract = this->current.is(token_type::minus);
+					this->advance();
+
+					const expression term = this->parse_term();
+
+					if(!term.is_resolved())
+					{
+						if(subtract || !result.is_resolved())
+							this->fail("an expression may only add a single forward reference");
+
+						if(result.is_relocatable())
+							this->fail("an expression may only add a single relocatable label");
+
+						result.symbol = term.symbol;
+					}
+					else if(term.is_relocatable())
+					{
+						if(subtract)
+						{
+							if(term.section != result.section)
+								this->fail("only labels from the same section may be subtracted");
+
+							result.section = no_section;
+						}
+						else
+						{
+							if(result.is_relocatable() || !result.is_resolved())
+								this->fail("an expression may only add a single relocatable label");
+
+							result.section = term.section;
+						}
+					}
+
+					result.value = subtract ? (result.value - term.value) : (result.value + term.value);
+				}
+
+				return result;
+			}
+
+			operand parse_operand()
+			{
+				operand result { operand_type::none, register_id::reg_0, expression { 0, no_symbol, no_section } };
+
+				if(this->current.is(token_type::left_bracket))
+				{
+					this->advance();
+
+					if(!this->current.is_keyword("i"))
+						this->fail("only [i] may be used indirectly");
+
+					this->advance();
+					this->expect(token_type::right_bracket, "expected ]");
+
+					result.type = operand_type::indirect_i;
+					return result;
+				}
+
+				if(this->current.is(token_type::identifier))
+				{
+					const token & name = this->current;
+
+					if(name.length == 2 && token::to_lower(name.text[0]) == 'v' && get_hex_digit(name.text[1]) < 16)
+					{
+						result.type = operand_type::v_register;
+						result.reg = static_cast<register_id>(get_hex_digit(name.text[1]));
+					}
+					else if(name.is_keyword("i"))
+						result.type = operand_type::i_register;
+					else if(name.is_keyword("dt"))
+						result.type = operand_type::delay_timer;
+					else if(name.is_keyword("st"))
+						result.type = operand_type::sound_timer;
+					else if(name.is_keyword("k"))
+						result.type = operand_type::key;
+					else if(name.is_keyword("f"))
+						result.type = operand_type::font;
+					else if(name.is_keyword("hf"))
+						result.type = operand_type::big_font;
+					else if(name.is_keyword("b"))
+						result.type = operand_type::bcd;
+					else if(name.is_keyword("r"))
+						result.type = operand_type::flags;
+					else if(name.is_keyword("long"))
+					{
+						this->advance();
+						result.type = operand_type::long_value;
+						result.value = this->parse_expression();
+						return result;
+					}
+
+					if(result.type != operand_type::none)
+					{
+						this->advance();
+						return result;
+					}
+				}
+
+				result.type = operand_type::value;
+				result.value = this->parse_expression();
+				return result;
+			}
+
+			static unsigned get_hex_digit(char value)
+			{
+				return ((value >= '0') && (value <= '9')) ? static_cast<unsigned>(value - '0')
+					: ((value >= 'a') && (value <= 'f')) ? static_cast<unsigned>(value - 'a' + 10)
+					: ((value >= 'A') && (value <= 'F')) ? static_cast<unsigned>(value - 'A' + 10)
+					: 0xFF;
+			}
+
+			std::size_t parse_operands(operand * operands, std::size_t capacity)
+			{
+				if(this->current.is(token_type::end_of_line) || this->current.is(token_type::end))
+					return 0;
+
+				std::size_t count = 0;
+
+				while(true)
+				{
+					if(count == capacity)
+						this->fail("too many operands");
+
+					operands[count] = this->parse_operand();
+					++count;
+
+					if(!this->current.is(token_type::comma))
+						return count;
+
+					this->advance();
+				}
+			}
+
+			// Checks a resolved value, or records where an unresolved one must be patched
+			std::int32_t use(const expression & value, fixup_kind kind)
+			{
+				if(!value.is_resolved())
+				{
+					this->fixups.push_back(fixup { this->get_offset(), value.symbol, value.value, kind, this->source->get_line(), this->section_index });
+					return 0;
+				}
+
+				if(value.is_relocatable())
+				{
+					this->relocate(this->section_index, this->get_offset(), kind, relocation_target::section, value.section, value.value, this->source->get_line());
+					return 0;
+				}
+
+				if(!is_in_range(value.value, kind))
+					this->fail("value is out of range");
+
+				return value.value;
+			}
+
+			static bool is_in_range(std::int32_t value, fixup_kind kind)
+			{
+				switch(kind)
+				{
+					case fixup_kind::address: return (value >= 0) && (value <= 0xFFF);
+					case fixup_kind::immediate: return (value >= -0x80) && (value <= 0xFF);
+					case fixup_kind::nibble: return (value >= 0) && (value <= 0xF);
+					case fixup_kind::word: return (value >= -0x8000) && (value <= 0xFFFF);
+					case fixup_kind::data_byte: return (value >= -0x80) && (value <= 0xFF);
+					default: return false;
+				}
+			}
+
+			pointer use_address(const operand & value)
+			{
+				return static_cast<pointer>(this->use(value.value, fixup_kind::address));
+			}
+
+			byte use_immediate(const operand & value)
+			{
+				return static_cast<byte>(this->use(value.value, fixup_kind::immediate));
+			}
+
+			byte use_nibble(const operand & value)
+			{
+				return static_cast<byte>(this->use(value.value, fixup_kind::nibble));
+			}
+
+			void parse_instruction(mnemonic instruction)
+			{
+				if(instruction == mnemonic::unknown)
+					this->fail("unknown mnemonic");
+
+				if(instruction == mnemonic::db || instruction == mnemonic::dw)
+				{
+					this->parse_data(instruction == mnemonic::dw);
+					return;
+				}
+
+				if(instruction == mnemonic::global)
+				{
+					this->parse_global();
+					return;
+				}
+
+				if(instruction == mnemonic::section)
+				{
+					this->parse_section();
+					return;
+				}
+
+				operand operands[3] {};
+				const std::size_t count = this->parse_operands(operands, 3);
+
+				const auto is_form = [&operands, count](std::size_t expected_count, operand_type first, operand_type second, operand_type third)
+				{
+					return (count == expected_count)
+						&& (expected_count < 1 || operands[0].type == first)
+						&& (expected_count < 2 || operands[1].type == second)
+						&& (expected_count < 3 || operands[2].type == third);
+				};
+
+				const auto form0 = [&]() { return is_form(0, operand_type::none, operand_type::none, operand_type::none); };
+				const auto form1 = [&](operand_type first) { return is_form(1, first, operand_type::none, operand_type::none); };
+				const auto form2 = [&](operand_type first, operand_type second) { return is_form(2, first, second, operand_type::none); };
+
+				constexpr auto value = operand_type::value;
+				constexpr auto vx = operand_type::v_register;
+
+				const register_id x = operands[0].reg;
+				const register_id y = operands[1].reg;
+
+				switch(instruction)
+				{
+					case mnemonic::cls: if(form0()) return this->encoder.encode_clear_screen(); break;
+					case mnemonic::ret: if(form0()) return this->encoder.encode_return(); break;
+					case mnemonic::exit: if(form0()) return this->encoder.encode_exit(); break;
+					case mnemonic::scr: if(form0()) return this->encoder.encode_scroll_right(); break;
+					case mnemonic::scl: if(form0()) return this->encoder.encode_scroll_left(); break;
+					case mnemonic::low: if(form0()) return this->encoder.encode_low_resolution(); break;
+					case mnemonic::high: if(form0()) return this->encoder.encode_high_resolution(); break;
+					case mnemonic::scd: if(form1(value)) return this->encoder.encode_scroll_down(this->use_nibble(operands[0])); break;
+					case mnemonic::scu: if(form1(value)) return this->encoder.encode_scroll_up(this->use_nibble(operands[0])); break;
+					case mnemonic::plane: if(form1(value)) return this->encoder.encode_select_planes(this->use_nibble(operands[0])); break;
+
+					case mnemonic::jp:
+						if(form1(value))
+							return this->encoder.encode_jump(this->use_address(operands[0]));
+						if(form2(vx, value) && x == register_id::reg_0)
+							return this->encoder.encode_jump_register_0(this->use_address(operands[1]));
+						break;
+
+					case mnemonic::call: if(form1(value)) return this->encoder.encode_call(this->use_address(operands[0])); break;
+					case mnemonic::skp: if(form1(vx)) return this->encoder.encode_skip_if_key_pressed(x); break;
+					case mnemonic::sknp: if(form1(vx)) return this->encoder.encode_skip_if_key_not_pressed(x); break;
+					case mnemonic::save: if(form2(vx, vx)) return this->encoder.encode_store_registers_range(x, y); break;
+					case mnemonic::load: if(form2(vx, vx)) return this->encoder.encode_load_registers_range(x, y); break;
+					case mnemonic::rnd: if(form2(vx, value)) return this->encoder.encode_random(x, this->use_immediate(operands[1])); break;
+					case mnemonic::or_: if(form2(vx, vx)) return this->encoder.encode_or(x, y); break;
+					case mnemonic::and_: if(form2(vx, vx)) return this->encoder.encode_and(x, y); break;
+					case mnemonic::xor_: if(form2(vx, vx)) return this->encoder.encode_xor(x, y); break;
+					case mnemonic::sub: if(form2(vx, vx)) return this->encoder.encode_subtract(x, y); break;
+					case mnemonic::subn: if(form2(vx, vx)) return this->encoder.encode_reverse_subtract(x, y); break;
+
+					case mnemonic::shr:
+						if(form1(vx)) return this->encoder.encode_shift_right(x, x);
+						if(form2(vx, vx)) return this->encoder.encode_shift_right(x, y);
+						break;
+
+					case mnemonic::shl:
+						if(form1(vx)) return this->encoder.encode_shift_left(x, x);
+						if(form2(vx, vx)) return this->encoder.encode_shift_left(x, y);
+						break;
+
+					case mnemonic::se:
+						if(form2(vx, value)) return this->encoder.encode_skip_if_equal(x, this->use_immediate(operands[1]));
+						if(form2(vx, vx)) return this->encoder.encode_skip_if_equal(x, y);
+						break;
+
+					case mnemonic::sne:
+						if(form2(vx, value)) return this->encoder.encode_skip_if_not_equal(x, this->use_immediate(operands[1]));
+						if(form2(vx, vx)) return this->encoder.encode_skip_if_not_equal(x, y);
+						break;
+
+					case mnemonic::add:
+						if(form2(vx, value)) return this->encoder.encode_add(x, this->use_immediate(operands[1]));
+						if(form2(vx, vx)) return this->encoder.encode_add(x, y);
+						if(form2(operand_type::i_register, vx)) return this->encoder.encode_add_i_register(y);
+						break;
+
+					case mnemonic::drw:
+						if(is_form(3, vx, vx, value)) return this->encoder.encode_draw(x, y, this->use_nibble(operands[2]));
+						break;
+
+					case mnemonic::ld:
+						if(count == 2)
+							return this->parse_load(operands[0], operands[1]);
+						break;
+
+					default:
+						break;
+				}
+
+				this->fail("invalid operands");
+			}
+
+			void parse_load(const operand & destination, const operand & source)
+			{
+				const register_id x = destination.reg;
+				const register_id y = source.reg;
+
+				switch(destination.type)
+				{
+					case operand_type::v_register:
+						switch(source.type)
+						{
+							case operand_type::value: return this->encoder.encode_load(x, this->use_immediate(source));
+							case operand_type::v_register: return this->encoder.encode_load(x, y);
+							case operand_type::delay_timer: return this->encoder.encode_read_delay_timer(x);
+							case operand_type::key: return this->encoder.encode_await_key_press(x);
+							case operand_type::indirect_i: return this->encoder.encode_load_registers_i(x);
+							case operand_type::flags: return this->encoder.encode_load_flags(x);
+							default: break;
+						}
+						break;
+
+					case operand_type::i_register:
+						if(source.type == operand_type::value)
+							return this->encoder.encode_load_i(this->use_address(source));
+
+						// The address follows the F000 prefix word
+						if(source.type == operand_type::long_value)
+						{
+							const bool is_deferred = (!source.value.is_resolved() || source.value.is_relocatable());
+
+							if(!source.value.is_resolved())
+								this->fixups.push_back(fixup { this->get_offset() + 2, source.value.symbol, source.value.value, fixup_kind::word, this->source->get_line(), this->section_index });
+							else if(source.value.is_relocatable())
+								this->relocate(this->section_index, this->get_offset() + 2, fixup_kind::word, relocation_target::section, source.value.section, source.value.value, this->source->get_line());
+							else if(!is_in_range(source.value.value, fixup_kind::word))
+								this->fail("value is out of range");
+
+							this->encoder.encode_load_i_long(static_cast<word>(is_deferred ? 0 : source.value.value));
+							return;
+						}
+						break;
+
+					case operand_type::delay_timer: if(source.type == operand_type::v_register) return this->encoder.encode_write_delay_timer(y); break;
+					case operand_type::sound_timer: if(source.type == operand_type::v_register) return this->encoder.encode_write_sound_timer(y); break;
+					case operand_type::font: if(source.type == operand_type::v_register) return this->encoder.encode_load_digit_sprite(y); break;
+					case operand_type::big_font: if(source.type == operand_type::v_register) return this->encoder.encode_load_big_digit_sprite(y); break;
+					case operand_type::bcd: if(source.type == operand_type::v_register) return this->encoder.encode_load_bcd(y); break;
+					case operand_type::indirect_i: if(source.type == operand_type::v_register) return this->encoder.encode_store_registers_i(y); break;
+					case operand_type::flags: if(source.type == operand_type::v_register) return this->encoder.encode_store_flags(y); break;
+
+					default:
+						break;
+				}
+
+				this->fail("invalid operands");
+			}
+
+			void parse_data(bool is_word)
+			{
+				const fixup_kind kind = is_word ? fixup_kind::word : fixup_kind::data_byte;
+
+				while(true)
+				{
+					const std::int32_t value = this->use(this->parse_expression(), kind);
+
+					if(is_word)
+						this->writer.write_word_big_endian(static_cast<word>(value));
+					else
+						this->writer.write_byte(static_cast<byte>(value));
+
+					if(!this->current.is(token_type::comma))
+						return;
+
+					this->advance();
+				}
+			}
+
+			// Exports are listed by name, and may come before or after their definitions
+			void parse_global()
+			{
+				while(true)
+				{
+					if(!this->current.is(token_type::identifier))
+						this->fail("expected a symbol");
+
+					this->exports.push_back(this->symbols.intern(this->current.text, this->current.length, this->source->get_line()));
+					this->advance();
+
+					if(!this->current.is(token_type::comma))
+						return;
+
+					this->advance();
+				}
+			}
+
+			void parse_section()
+			{
+				if(!this->is_object)
+					this->fail("sections are only available when assembling an object");
+
+				if(!this->current.is(token_type::identifier))
+					this->fail("expected a section name");
+
+				const token & name = this->current;
+				auto & sections = this->object.sections;
+
+				std::uint32_t index = 0;
+
+				while(index < sections.size() && sections[index].name.compare(0, std::string::npos, name.text, name.length) != 0)
+					++index;
+
+				if(index == sections.size())
+					sections.push_back(object_section { std::string(name.text, name.length), {} });
+
+				this->advance();
+
+				// Only the current section's bytes live in the writer, so switching swaps them in and out
+				if(index != this->section_index)
+				{
+					std::swap(this->writer.get_container(), sections[this->section_index].bytes);
+					this->section_index = index;
+					std::swap(this->writer.get_container(), sections[this->section_index].bytes);
+				}
+			}
+
+			void relocate(std::uint32_t section, std::size_t offset, fixup_kind kind, relocation_target target, std::uint32_t index, std::int32_t addend, std::size_t line)
+			{
+				if(kind != fixup_kind::address && kind != fixup_kind::word)
+					throw assembly_exception("a relocatable address must be used as an address or word", line);
+
+				const relocation_kind relocation_type = (kind == fixup_kind::address) ? relocation_kind::address : relocation_kind::word;
+				this->object.relocations.push_back(relocation { section, static_cast<std::uint32_t>(offset), relocation_type, target, index, addend });
+			}
+
+			void export_symbols()
+			{
+				this->object_symbols.assign(this->symbols.size(), std::uint32_t(no_symbol));
+
+				for(const auto index : this->exports)
+				{
+					const symbol & entry = this->symbols[index];
+
+					if(!entry.is_defined())
+						throw assembly_exception("exported symbol is not defined", entry.line);
+
+					if(this->object_symbols[index] != no_symbol)
+						continue;
+
+					this->object_symbols[index] = static_cast<std::uint32_t>(this->object.symbols.size());
+
+					const std::uint32_t section = (entry.kind == symbol_kind::label) ? entry.section : object_symbol::absolute;
+					this->object.symbols.push_back(object_symbol { std::string(entry.name, entry.length), symbol_binding::exported, section, entry.value });
+				}
+			}
+
+			// Symbols that were never defined are imported rather than reported
+			std::uint32_t import_symbol(symbol_table::index_type index)
+			{
+				if(this->object_symbols[index] == no_symbol)
+				{
+					const symbol & entry = this->symbols[index];
+
+					this->object_symbols[index] = static_cast<std::uint32_t>(this->object.symbols.size());
+					this->object.symbols.push_back(object_symbol { std::string(entry.name, entry.length), symbol_binding::imported, object_symbol::absolute, 0 });
+				}
+
+				return this->object_symbols[index];
+			}
+
+			container_type & get_section_bytes(std::uint32_t section)
+			{
+				return this->is_object ? this->object.sections[section].bytes : this->writer.get_container();
+			}
+
+			void patch(container_type & program, std::size_t offset, fixup_kind kind, std::int32_t value)
+			{
+				switch(kind)
+				{
+					case fixup_kind::address:
+						program[offset + 0] = static_cast<byte>((program[offset + 0] & 0xF0) | ((value >> 8) & 0x0F));
+						program[offset + 1] = static_cast<byte>(value & 0xFF);
+						break;
+
+					case fixup_kind::immediate:
+						program[offset + 1] = static_cast<byte>(value & 0xFF);
+						break;
+
+					case fixup_kind::nibble:
+						program[offset + 1] = static_cast<byte>((program[offset + 1] & 0xF0) | (value & 0x0F));
+						break;
+
+					case fixup_kind::word:
+						program[offset + 0] = static_cast<byte>((value >> 8) & 0xFF);
+						program[offset + 1] = static_cast<byte>(value & 0xFF);
+						break;
+
+					case fixup_kind::data_byte:
+						program[offset + 0] = static_cast<byte>(value & 0xFF);
+						break;
+				}
+			}
+
+			void apply_fixups()
+			{
+				for(const auto & entry : this->fixups)
+				{
+					const symbol & target = this->symbols[entry.symbol];
+
+					if(this->is_object && !target.is_defined())
+					{
+						this->relocate(entry.section, entry.offset, entry.kind, relocation_target::symbol, this->import_symbol(entry.symbol), entry.addend, entry.line);
+						continue;
+					}
+
+					if(!target.is_defined())
+						throw assembly_exception("undefined symbol", entry.line);
+
+					const std::int32_t value = (static_cast<std::int32_t>(target.value) + entry.addend);
+
+					if(this->is_object && target.kind == symbol_kind::label)
+					{
+						this->relocate(entry.section, entry.offset, entry.kind, relocation_target::section, target.section, value, entry.line);
+						continue;
+					}
+
+					if(!is_in_range(value, entry.kind))
+						throw assembly_exception("value is out of range", entry.line);
+
+					this->patch(this->get_section_bytes(entry.section), entry.offset, entry.kind, value);
+				}
+			}
+		};
+	}
+}
\ No newline at end of file
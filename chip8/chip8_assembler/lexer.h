@@ -0,0 +1,249 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+
+namespace chip8
+{
+	namespace assembler
+	{
+		enum class token_type
+		{
+			end,
+			end_of_line,
+			identifier,
+			number,
+			comma,
+			colon,
+			equals,
+			plus,
+			minus,
+			left_bracket,
+			right_bracket,
+			invalid,
+		};
+
+		// Tokens point back into the source rather than owning copies of their text
+		struct token
+		{
+			token_type type;
+			const char * text;
+			std::size_t length;
+			std::uint32_t value;
+
+			bool is(token_type type) const
+			{
+				return (this->type == type);
+			}
+
+			// Case-insensitive, for mnemonics and register names
+			bool is_keyword(const char * keyword) const
+			{
+				if(this->type != token_type::identifier)
+					return false;
+
+				for(std::size_t index = 0; index < this->length; ++index, ++keyword)
+				{
+					if(*keyword == '\0')
+						return false;
+
+					if(to_lower(this->text[index]) != *keyword)
+						return false;
+				}
+
+				return (*keyword == '\0');
+			}
+
+			static constexpr char to_lower(char value)
+			{
+				return ((value >= 'A') && (value <= 'Z')) ? static_cast<char>(value - 'A' + 'a') : value;
+			}
+		};
+
+		// Produces one token at a time without buffering or allocating,
+		// so a source is lexed in a single pass however large it is
+		class lexer
+		{
+		private:
+			const char * current;
+			const char * end;
+			std::size_t line = 1;
+			bool at_line_start = false;
+
+		public:
+			lexer(const char * begin, const char * end) :
+				current(begin), end(end)
+			{
+			}
+
+			// The line of the most recent token
+			std::size_t get_line() const
+			{
+				return this->line;
+			}
+
+			token next()
+			{
+				if(this->at_line_start)
+				{
+					++this->line;
+					this->at_line_start = false;
+				}
+
+				this->skip_space();
+
+				if(this->current == this->end)
+					return this->make(token_type::end, this->current, 0);
+
+				const char * start = this->current;
+				const char next = *this->current;
+
+				if(next == '\n')
+				{
+					++this->current;
+					this->at_line_start = true;
+					return this->make(token_type::end_of_line, start, 1);
+				}
+
+				if(is_identifier_start(next))
+				{
+					while(this->current != this->end && is_identifier_part(*this->current))
+						++this->current;
+
+					return this->make(token_type::identifier, start, static_cast<std::size_t>(this->current - start));
+				}
+
+				if(is_digit(next) || next == '#' || next == '$' || next == '%')
+					return this->lex_number();
+
+				++this->current;
+
+				switch(next)
+				{
+					case ',': return this->make(token_type::comma, start, 1);
+					case ':': return this->make(token_type::colon, start, 1);
+					case '=': return this->make(token_type::equals, start, 1);
+					case '+': return this->make(token_type::plus, start, 1);
+					case '-': return this->make(token_type::minus, start, 1);
+					case '[': return this->make(token_type::left_bracket, start, 1);
+					case ']': return this->make(token_type::right_bracket, start, 1);
+					default: return this->make(token_type::invalid, start, 1);
+				}
+			}
+
+			// Discards the rest of the current line, up to but not including its end
+			void skip_line()
+			{
+				const void * found = std::memchr(this->current, '\n', static_cast<std::size_t>(this->end - this->current));
+				this->current = (found != nullptr) ? static_cast<const char *>(found) : this->end;
+			}
+
+		private:
+			token make(token_type type, const char * text, std::size_t length, std::uint32_t value = 0) const
+			{
+				return token { type, text, length, value };
+			}
+
+			void skip_space()
+			{
+				while(this->current != this->end)
+				{
+					const char next = *this->current;
+
+					if(next == ' ' || next == '\t' || next == '\r')
+						++this->current;
+					else if(next == ';')
+						this->skip_line();
+					else
+						break;
+				}
+			}
+
+			// Accepts 123, 0x7B, #7B, $7B, 0b1111011 and %1111011
+			token lex_number()
+			{
+				const char * start = this->current;
+				unsigned base = 10;
+
+				if(*this->current == '#' || *this->current == '$')
+				{
+					base = 16;
+					++this->current;
+				}
+				else if(*this->current == '%')
+				{
+					base = 2;
+					++this->current;
+				}
+				else if(*this->current == '0' && (this->end - this->current) > 1)
+				{
+					const char prefix = token::to_lower(this->current[1]);
+
+					if(prefix == 'x')
+					{
+						base = 16;
+						this->current += 2;
+					}
+					else if(prefix == 'b')
+					{
+						base = 2;
+						this->current += 2;
+					}
+				}
+
+				const char * digits = this->current;
+				std::uint32_t value = 0;
+				bool overflow = false;
+
+				while(this->current != this->end)
+				{
+					const unsigned digit = get_digit_value(*this->current);
+
+					if(digit >= base)
+						break;
+
+					overflow |= (value > ((UINT32_MAX - digit) / base));
+					value = ((value * base) + digit);
+					++this->current;
+				}
+
+				const std::size_t length = static_cast<std::size_t>(this->current - start);
+
+				// Digits running into letters, as in 12ab, are not a number
+				if(digits == this->current || overflow || (this->current != this->end && is_identifier_part(*this->current)))
+				{
+					while(this->current != this->end && is_identifier_part(*this->current))
+						++this->current;
+
+					return this->make(token_type::invalid, start, static_cast<std::size_t>(this->current - start));
+				}
+
+				return this->make(token_type::number, start, length, value);
+			}
+
+			static constexpr bool is_digit(char value)
+			{
+				return ((value >= '0') && (value <= '9'));
+			}
+
+			static constexpr bool is_identifier_start(char value)
+			{
+				return ((value >= 'a') && (value <= 'z')) || ((value >= 'A') && (value <= 'Z')) || (value == '_') || (value == '.');
+			}
+
+			static constexpr bool is_identifier_part(char value)
+			{
+				return is_identifier_start(value) || is_digit(value);
+			}
+
+			static constexpr unsigned get_digit_value(char value)
+			{
+				return is_digit(value) ? static_cast<unsigned>(value - '0')
+					: ((value >= 'a') && (value <= 'f')) ? static_cast<unsigned>(value - 'a' + 10)
+					: ((value >= 'A') && (value <= 'F')) ? static_cast<unsigned>(value - 'A' + 10)
+					: 0xFF;
+			}
+		};
+	}
+}
\ No newline at end of file
@@ -0,0 +1,246 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+#include <unordered_map>
+#include <algorithm>
+#include <stdexcept>
+
+#include "chip8/base_types.h"
+
+#include "object_file.h"
+#include "symbol_table.h"
+
+namespace chip8
+{
+	namespace assembler
+	{
+		class link_exception : public std::runtime_error
+		{
+		private:
+			std::string name;
+
+		public:
+			link_exception(const char * message, const std::string & name) :
+				std::runtime_error(message), name(name)
+			{
+			}
+
+			// The symbol or section the error concerns
+			const std::string & get_name() const
+			{
+				return this->name;
+			}
+		};
+
+		// Lays out every section of every module, with sections of the same name kept together
+		// in order of first appearance, then resolves symbols and applies relocations in one pass.
+		// Modules are held by pointer, so a changed module can be replaced and the image relinked
+		// without reassembling the rest
+		class linker
+		{
+		public:
+			using container_type = std::vector<byte>;
+
+		public:
+			static constexpr pointer program_offset = 0x200;
+			static constexpr std::uint32_t memory_end = 0x1000;
+
+		private:
+			struct section_reference
+			{
+				std::size_t module;
+				std::size_t section;
+			};
+
+		private:
+			std::vector<const object_module *> modules;
+
+			symbol_table symbols;
+
+			// Flattened over every module, each module's entries starting at its first index
+			std::vector<std::uint32_t> section_addresses;
+			std::vector<std::uint32_t> symbol_addresses;
+			std::vector<std::size_t> first_sections;
+			std::vector<std::size_t> first_symbols;
+
+			// Sections grouped by name, in order of first appearance
+			std::unordered_map<std::string, std::size_t> group_indices;
+			std::vector<std::vector<section_reference>> groups;
+
+			container_type image;
+
+		public:
+			std::size_t add_module(const object_module & module)
+			{
+				this->modules.push_back(&module);
+				return (this->modules.size() - 1);
+			}
+
+			void replace_module(std::size_t index, const object_module & module)
+			{
+				this->modules[index] = &module;
+			}
+
+			void clear()
+			{
+				this->modules.clear();
+				this->image.clear();
+			}
+
+			const container_type & link(pointer origin = program_offset)
+			{
+				this->place_sections(origin);
+				this->resolve_symbols();
+
+				for(std::size_t index = 0; index < this->modules.size(); ++index)
+					this->copy_module(index, origin);
+
+				return this->image;
+			}
+
+			const container_type & get_image() const
+			{
+				return this->image;
+			}
+
+			// The address a module's section was placed at by the last link
+			std::uint32_t get_section_address(std::size_t module, std::size_t section) const
+			{
+				return this->section_addresses[this->first_sections[module] + section];
+			}
+
+			const symbol * find_symbol(const std::string & name) const
+			{
+				return this->symbols.find(name.data(), name.size());
+			}
+
+		private:
+			void place_sections(pointer origin)
+			{
+				this->first_sections.clear();
+				this->group_indices.clear();
+
+				for(auto & group : this->groups)
+					group.clear();
+
+				std::size_t section_count = 0;
+				std::size_t group_count = 0;
+
+				for(std::size_t module = 0; module < this->modules.size(); ++module)
+				{
+					const auto & sections = this->modules[module]->sections;
+
+					this->first_sections.push_back(section_count);
+					section_count += sections.size();
+
+					for(std::size_t section = 0; section < sections.size(); ++section)
+					{
+						const auto result = this->group_indices.emplace(sections[section].name, group_count);
+
+						if(result.second && (++group_count > this->groups.size()))
+							this->groups.emplace_back();
+
+						this->groups[result.first->second].push_back(section_reference { module, section });
+					}
+				}
+
+				this->section_addresses.assign(section_count, 0);
+
+				std::uint32_t address = origin;
+
+				for(std::size_t group = 0; group < group_count; ++group)
+					for(const auto & entry : this->groups[group])
+					{
+						const auto & section = this->modules[entry.module]->sections[entry.section];
+
+						this->section_addresses[this->first_sections[entry.module] + entry.section] = address;
+						address += static_cast<std::uint32_t>(section.bytes.size());
+
+						if(address > memory_end)
+							throw link_exception("program does not fit in memory", section.name);
+					}
+
+				this->image.assign(address - origin, 0);
+			}
+
+			void resolve_symbols()
+			{
+				this->symbols.clear();
+				this->first_symbols.clear();
+
+				std::size_t symbol_count = 0;
+
+				for(std::size_t module = 0; module < this->modules.size(); ++module)
+				{
+					this->first_symbols.push_back(symbol_count);
+
+					for(const auto & entry : this->modules[module]->symbols)
+					{
+						if(entry.binding != symbol_binding::exported)
+							continue;
+
+						symbol & target = this->symbols[this->symbols.intern(entry.name.data(), entry.name.size(), 0)];
+
+						if(target.is_defined())
+							throw link_exception("duplicate symbol", entry.name);
+
+						target.kind = (entry.section == object_symbol::absolute) ? symbol_kind::constant : symbol_kind::label;
+						target.value = (entry.section == object_symbol::absolute) ? entry.value : (this->get_section_address(module, entry.section) + entry.value);
+					}
+
+					symbol_count += this->modules[module]->symbols.size();
+				}
+
+				// Imports are looked up once each, rather than once per relocation
+				this->symbol_addresses.resize(symbol_count);
+
+				for(std::size_t module = 0; module < this->modules.size(); ++module)
+				{
+					const auto & module_symbols = this->modules[module]->symbols;
+
+					for(std::size_t index = 0; index < module_symbols.size(); ++index)
+					{
+						const symbol * target = this->find_symbol(module_symbols[index].name);
+
+						if(target == nullptr || !target->is_defined())
+							throw link_exception("undefined symbol", module_symbols[index].name);
+
+						this->symbol_addresses[this->first_symbols[module] + index] = target->value;
+					}
+				}
+			}
+
+			void copy_module(std::size_t module_index, pointer origin)
+			{
+				const object_module & module = *this->modules[module_index];
+
+				for(std::size_t index = 0; index < module.sections.size(); ++index)
+				{
+					const auto & bytes = module.sections[index].bytes;
+					static_cast<void>(std::copy(bytes.begin(), bytes.end(), this->image.begin() + (this->get_section_address(module_index, index) - origin)));
+				}
+
+				for(const auto & entry : module.relocations)
+				{
+					const std::uint32_t target = (entry.target == relocation_target::section)
+						? this->get_section_address(module_index, entry.index)
+						: this->symbol_addresses[this->first_symbols[module_index] + entry.index];
+
+					const std::int64_t value = (static_cast<std::int64_t>(target) + entry.addend);
+
+					if(!entry.is_in_range(value))
+					{
+						const auto & name = (entry.target == relocation_target::section) ? module.sections[entry.index].name : module.symbols[entry.index].name;
+						throw link_exception("address is out of range", name);
+					}
+
+					const std::size_t location = (this->get_section_address(module_index, entry.section) - origin + entry.offset);
+					entry.apply(&this->image[location], static_cast<std::uint32_t>(value));
+				}
+			}
+		};
+	}
+}
\ No newline at end of file
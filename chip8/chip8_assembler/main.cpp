@@ -1,10 +1,299 @@
+#include <cstdlib>
+#include <cstring>
 #include <iostream>
+#include <fstream>
+#include <sstream>
+#include <string>
+#include <vector>
+#include <thread>
+#include <mutex>
+#include <atomic>
+#include <algorithm>
+#include <memory>
+
+#include <sys/types.h>
+#include <sys/stat.h>
+
+#include "chip8/disassembler.h"
+
+#include "mapped_file.h"
+#include "assembler.h"
+#include "object_file.h"
+#include "linker.h"
+
+struct assembly_job
+{
+	std::string input_path;
+	std::string output_path;
+	bool is_object;
+};
+
+std::string get_default_output_path(const std::string & input_path, const char * extension = ".ch8")
+{
+	const auto separator = input_path.find_last_of("/\\");
+	const auto dot = input_path.find_last_of('.');
+
+	if(dot == std::string::npos || (separator != std::string::npos && dot < separator))
+		return (input_path + extension);
+
+	return (input_path.substr(0, dot) + extension);
+}
+
+// Returns zero for a file that does not exist
+std::int64_t get_modification_time(const std::string & path)
+{
+	struct stat status;
+	return (::stat(path.c_str(), &status) == 0) ? static_cast<std::int64_t>(status.st_mtime) : 0;
+}
+
+bool write_file(const std::string & path, const std::vector<chip8::byte> & bytes)
+{
+	std::ofstream output(path, std::ios::binary);
+	output.write(reinterpret_cast<const char *>(bytes.data()), static_cast<std::streamsize>(bytes.size()));
+
+	return static_cast<bool>(output);
+}
+
+// Returns an empty string on success, otherwise a diagnostic for the job
+std::string assemble_file(chip8::assembler::source_assembler & assembler, const assembly_job & job)
+{
+	try
+	{
+		const chip8::assembler::mapped_file input(job.input_path);
+
+		if(job.is_object)
+		{
+			std::vector<chip8::byte> object;
+			assembler.assemble_object(input.begin(), input.end()).save(object);
+
+			if(!write_file(job.output_path, object))
+				return (job.output_path + ": unable to write output file");
+		}
+		else if(!write_file(job.output_path, assembler.assemble(input.begin(), input.end())))
+		{
+			return (job.output_path + ": unable to write output file");
+		}
+
+		return std::string();
+	}
+	catch(const chip8::assembler::assembly_exception & exception)
+	{
+		std::ostringstream message;
+		message << job.input_path << '(' << exception.get_line() << "): " << exception.what();
+		return message.str();
+	}
+	catch(const std::exception & exception)
+	{
+		return (job.input_path + ": " + exception.what());
+	}
+}
+
+// Each worker owns an assembler, so its buffers are reused from one file to the next
+bool assemble_all(const std::vector<assembly_job> & jobs)
+{
+	const std::size_t hardware_threads = std::max<std::size_t>(1, std::thread::hardware_concurrency());
+	const std::size_t thread_count = std::min(hardware_threads, jobs.size());
+
+	std::atomic<std::size_t> next_job { 0 };
+	std::atomic<bool> succeeded { true };
+	std::mutex error_mutex;
+
+	const auto worker = [&]()
+	{
+		chip8::assembler::source_assembler assembler;
+
+		for(std::size_t index = next_job++; index < jobs.size(); index = next_job++)
+		{
+			const std::string error = assemble_file(assembler, jobs[index]);
+
+			if(!error.empty())
+			{
+				succeeded = false;
+
+				const std::lock_guard<std::mutex> lock(error_mutex);
+				std::cerr << error << '\n';
+			}
+		}
+	};
+
+	std::vector<std::thread> threads;
+	threads.reserve(thread_count);
+
+	for(std::size_t index = 1; index < thread_count; ++index)
+		threads.emplace_back(worker);
+
+	worker();
+
+	for(auto & thread : threads)
+		thread.join();
+
+	return succeeded;
+}
+
+// Disassembles with the XO-CHIP set, which decodes every word the smaller sets do
+bool disassemble_file(const std::string & input_path, const char * output_path, bool listing)
+{
+	const chip8::assembler::mapped_file input(input_path);
+	const auto program = reinterpret_cast<const chip8::byte *>(input.begin());
+
+	const chip8::disassembler disassembler(chip8::instruction_set::xo_chip);
+
+	chip8::label_set labels;
+	disassembler.find_labels(program, input.get_size(), 0x200, labels);
+
+	chip8::disassembly_options options;
+	options.listing = listing;
+	options.labels = &labels;
+
+	std::vector<char> text(chip8::disassembler::get_output_capacity(input.get_size()));
+	const auto length = disassembler.disassemble(program, input.get_size(), text.data(), options);
+
+	if(output_path == nullptr)
+	{
+		std::cout.write(text.data(), static_cast<std::streamsize>(length));
+		return static_cast<bool>(std::cout);
+	}
+
+	std::ofstream output(output_path, std::ios::binary);
+	output.write(text.data(), static_cast<std::streamsize>(length));
+
+	if(!output)
+	{
+		std::cerr << output_path << ": unable to write output file\n";
+		return false;
+	}
+
+	return true;
+}
+
+// Links in the order given, so the first module's code section starts the program
+bool link_files(const std::string & output_path, const std::vector<std::string> & object_paths)
+{
+	std::vector<std::unique_ptr<chip8::assembler::object_module>> modules;
+	chip8::assembler::linker linker;
+
+	for(const auto & path : object_paths)
+	{
+		try
+		{
+			const chip8::assembler::mapped_file input(path);
+			const auto bytes = reinterpret_cast<const chip8::byte *>(input.begin());
+
+			modules.emplace_back(new chip8::assembler::object_module());
+			modules.back()->load(bytes, bytes + input.get_size());
+			linker.add_module(*modules.back());
+		}
+		catch(const std::exception & exception)
+		{
+			std::cerr << path << ": " << exception.what() << '\n';
+			return false;
+		}
+	}
+
+	try
+	{
+		if(!write_file(output_path, linker.link()))
+		{
+			std::cerr << output_path << ": unable to write output file\n";
+			return false;
+		}
+	}
+	catch(const chip8::assembler::link_exception & exception)
+	{
+		std::cerr << output_path << ": " << exception.what() << " '" << exception.get_name() << "'\n";
+		return false;
+	}
+
+	return true;
+}
+
+// Only sources newer than their objects are reassembled before everything is relinked
+bool build_files(const std::string & output_path, const std::vector<std::string> & source_paths)
+{
+	std::vector<assembly_job> jobs;
+	std::vector<std::string> object_paths;
+
+	for(const auto & path : source_paths)
+	{
+		object_paths.push_back(get_default_output_path(path, ".o8"));
+
+		if(get_modification_time(path) >= get_modification_time(object_paths.back()))
+			jobs.push_back(assembly_job { path, object_paths.back(), true });
+	}
+
+	if(!jobs.empty() && !assemble_all(jobs))
+		return false;
+
+	return link_files(output_path, object_paths);
+}
+
+void print_usage(const char * name)
+{
+	std::cerr << "usage: " << name << " <input> [output]\n";
+	std::cerr << "       " << name << " --batch <input>...\n";
+	std::cerr << "       " << name << " --object <input>...\n";
+	std::cerr << "       " << name << " --link <output> <object>...\n";
+	std::cerr << "       " << name << " --build <output> <input>...\n";
+	std::cerr << "       " << name << " --disassemble <rom> [output]\n";
+	std::cerr << "       " << name << " --listing <rom> [output]\n";
+}
 
 int main(int argument_count, char * arguments[])
 {
 	try
 	{
-		return EXIT_SUCCESS;
+		const bool is_disassembly = (argument_count >= 3) && (std::strcmp(arguments[1], "--disassemble") == 0 || std::strcmp(arguments[1], "--listing") == 0);
+
+		if(is_disassembly && argument_count <= 4)
+		{
+			const bool listing = (std::strcmp(arguments[1], "--listing") == 0);
+			const char * output_path = (argument_count == 4) ? arguments[3] : nullptr;
+
+			return disassemble_file(arguments[2], output_path, listing) ? EXIT_SUCCESS : EXIT_FAILURE;
+		}
+
+		const bool is_link = (argument_count >= 4) && (std::strcmp(arguments[1], "--link") == 0 || std::strcmp(arguments[1], "--build") == 0);
+
+		if(is_link)
+		{
+			const std::vector<std::string> inputs(arguments + 3, arguments + argument_count);
+			const bool succeeded = (std::strcmp(arguments[1], "--link") == 0) ? link_files(arguments[2], inputs) : build_files(arguments[2], inputs);
+
+			return succeeded ? EXIT_SUCCESS : EXIT_FAILURE;
+		}
+
+		std::vector<assembly_job> jobs;
+
+		if(argument_count >= 3 && std::strcmp(arguments[1], "--batch") == 0)
+		{
+			for(int index = 2; index < argument_count; ++index)
+				jobs.push_back(assembly_job { arguments[index], get_default_output_path(arguments[index]), false });
+		}
+		else if(argument_count >= 3 && std::strcmp(arguments[1], "--object") == 0)
+		{
+			for(int index = 2; index < argument_count; ++index)
+				jobs.push_back(assembly_job { arguments[index], get_default_output_path(arguments[index], ".o8"), true });
+		}
+		else if(argument_count == 2)
+		{
+			jobs.push_back(assembly_job { arguments[1], get_default_output_path(arguments[1]), false });
+		}
+		else if(argument_count == 3)
+		{
+			jobs.push_back(assembly_job { arguments[1], arguments[2], false });
+		}
+		else
+		{
+			print_usage(arguments[0]);
+			return EXIT_FAILURE;
+		}
+
+		return assemble_all(jobs) ? EXIT_SUCCESS : EXIT_FAILURE;
+	}
+	catch(const std::exception & exception)
+	{
+		std::cerr << exception.what() << '\n';
+		return EXIT_FAILURE;
 	}
 	catch(...)
 	{
@@ -0,0 +1,183 @@
+#pragma once
+
+#include <cstddef>
+#include <string>
+#include <stdexcept>
+
+#if defined(_WIN32)
+#define WIN32_LEAN_AND_MEAN
+#define NOMINMAX
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#endif
+
+namespace chip8
+{
+	namespace assembler
+	{
+		class file_exception : public std::runtime_error
+		{
+		public:
+			file_exception(const char * message) :
+				std::runtime_error(message)
+			{
+			}
+		};
+
+		// A read-only view of a whole file, mapped rather than copied
+		// so the lexer can run straight over the page cache
+		class mapped_file
+		{
+		private:
+			const char * data = nullptr;
+			std::size_t size = 0;
+
+#if defined(_WIN32)
+			HANDLE file = INVALID_HANDLE_VALUE;
+			HANDLE mapping = nullptr;
+#else
+			int file = -1;
+#endif
+
+		public:
+			mapped_file() = default;
+
+			explicit mapped_file(const std::string & path)
+			{
+				this->open(path);
+			}
+
+			mapped_file(const mapped_file &) = delete;
+			mapped_file & operator =(const mapped_file &) = delete;
+
+			~mapped_file()
+			{
+				this->close();
+			}
+
+			const char * begin() const
+			{
+				return this->data;
+			}
+
+			const char * end() const
+			{
+				return (this->data + this->size);
+			}
+
+			std::size_t get_size() const
+			{
+				return this->size;
+			}
+
+#if defined(_WIN32)
+			void open(const std::string & path)
+			{
+				this->close();
+
+				this->file = CreateFileA(path.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_FLAG_SEQUENTIAL_SCAN, nullptr);
+
+				if(this->file == INVALID_HANDLE_VALUE)
+					throw file_exception("unable to open input file");
+
+				LARGE_INTEGER file_size;
+				if(!GetFileSizeEx(this->file, &file_size))
+				{
+					this->close();
+					throw file_exception("unable to read input file size");
+				}
+
+				// Empty files cannot be mapped
+				if(file_size.QuadPart == 0)
+					return;
+
+				this->mapping = CreateFileMappingA(this->file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+
+				if(this->mapping == nullptr)
+				{
+					this->close();
+					throw file_exception("unable to map input file");
+				}
+
+				this->data = static_cast<const char *>(MapViewOfFile(this->mapping, FILE_MAP_READ, 0, 0, 0));
+
+				if(this->data == nullptr)
+				{
+					this->close();
+					throw file_exception("unable to map input file");
+				}
+
+				this->size = static_cast<std::size_t>(file_size.QuadPart);
+			}
+
+			void close()
+			{
+				if(this->data != nullptr)
+					UnmapViewOfFile(this->data);
+
+				if(this->mapping != nullptr)
+					CloseHandle(this->mapping);
+
+				if(this->file != INVALID_HANDLE_VALUE)
+					CloseHandle(this->file);
+
+				this->data = nullptr;
+				this->size = 0;
+				this->mapping = nullptr;
+				this->file = INVALID_HANDLE_VALUE;
+			}
+#else
+			void open(const std::string & path)
+			{
+				this->close();
+
+				this->file = ::open(path.c_str(), O_RDONLY);
+
+				if(this->file < 0)
+					throw file_exception("unable to open input file");
+
+				struct stat status;
+				if(::fstat(this->file, &status) != 0)
+				{
+					this->close();
+					throw file_exception("unable to read input file size");
+				}
+
+				// Empty files cannot be mapped
+				if(status.st_size == 0)
+					return;
+
+				void * view = ::mmap(nullptr, static_cast<std::size_t>(status.st_size), PROT_READ, MAP_PRIVATE, this->file, 0);
+
+				if(view == MAP_FAILED)
+				{
+					this->close();
+					throw file_exception("unable to map input file");
+				}
+
+				static_cast<void>(::madvise(view, static_cast<std::size_t>(status.st_size), MADV_SEQUENTIAL));
+
+				this->data = static_cast<const char *>(view);
+				this->size = static_cast<std::size_t>(status.st_size);
+			}
+
+			void close()
+			{
+				if(this->data != nullptr)
+					static_cast<void>(::munmap(const_cast<char *>(this->data), this->size));
+
+				if(this->file >= 0)
+					static_cast<void>(::close(this->file));
+
+				this->data = nullptr;
+				this->size = 0;
+				this->file = -1;
+			}
+#endif
+		};
+	}
+}
\ No newline at end of file
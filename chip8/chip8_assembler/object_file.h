@@ -0,0 +1,342 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+#include <iterator>
+#include <stdexcept>
+
+#include "chip8/base_types.h"
+
+namespace chip8
+{
+	namespace assembler
+	{
+		class object_format_exception : public std::runtime_error
+		{
+		public:
+			object_format_exception(const char * message) :
+				std::runtime_error(message)
+			{
+			}
+		};
+
+		constexpr byte object_file_signature[] { 'C', '8', 'O', 'B' };
+		constexpr byte object_file_version = 1;
+
+		enum class relocation_kind : std::uint8_t
+		{
+			// The low 12 bits of an instruction
+			address,
+
+			// A whole big-endian word
+			word,
+		};
+
+		enum class relocation_target : std::uint8_t
+		{
+			// The start of one of the module's own sections
+			section,
+
+			// One of the module's symbols, usually an import
+			symbol,
+		};
+
+		struct relocation
+		{
+			std::uint32_t section;
+			std::uint32_t offset;
+			relocation_kind kind;
+			relocation_target target;
+			std::uint32_t index;
+			std::int32_t addend;
+
+			bool is_in_range(std::int64_t value) const
+			{
+				return (value >= 0) && (value <= ((this->kind == relocation_kind::address) ? 0xFFF : 0xFFFF));
+			}
+
+			void apply(byte * location, std::uint32_t value) const
+			{
+				if(this->kind == relocation_kind::address)
+					location[0] = static_cast<byte>((location[0] & 0xF0) | ((value >> 8) & 0x0F));
+				else
+					location[0] = static_cast<byte>((value >> 8) & 0xFF);
+
+				location[1] = static_cast<byte>(value & 0xFF);
+			}
+		};
+
+		enum class symbol_binding : std::uint8_t
+		{
+			exported,
+			imported,
+		};
+
+		struct object_symbol
+		{
+			static constexpr std::uint32_t absolute = UINT32_MAX;
+
+			std::string name;
+			symbol_binding binding;
+
+			// The section the value is relative to, or absolute for constants and imports
+			std::uint32_t section;
+			std::uint32_t value;
+		};
+
+		struct object_section
+		{
+			std::string name;
+			std::vector<byte> bytes;
+		};
+
+		// One assembled module whose addresses are still relative to its sections.
+		// Relocations are kept sorted by section and offset, so the saved form
+		// stores each offset as a distance from the one before it
+		class object_module
+		{
+		public:
+			std::vector<object_section> sections;
+			std::vector<object_symbol> symbols;
+			std::vector<relocation> relocations;
+
+		public:
+			void clear()
+			{
+				this->sections.clear();
+				this->symbols.clear();
+				this->relocations.clear();
+			}
+
+			void save(std::vector<byte> & output) const
+			{
+				output.insert(output.end(), std::begin(object_file_signature), std::end(object_file_signature));
+				output.push_back(object_file_version);
+
+				write_number(output, this->sections.size());
+
+				for(const auto & section : this->sections)
+				{
+					write_string(output, section.name);
+					write_number(output, section.bytes.size());
+					output.insert(output.end(), section.bytes.begin(), section.bytes.end());
+				}
+
+				write_number(output, this->symbols.size());
+
+				for(const auto & symbol : this->symbols)
+				{
+					write_string(output, symbol.name);
+					output.push_back(static_cast<byte>(symbol.binding));
+					write_number(output, (symbol.section == object_symbol::absolute) ? 0 : (std::size_t(symbol.section) + 1));
+					write_number(output, symbol.value);
+				}
+
+				write_number(output, this->relocations.size());
+
+				std::uint32_t section = 0;
+				std::uint32_t offset = 0;
+
+				for(const auto & entry : this->relocations)
+				{
+					if(entry.section != section)
+					{
+						section = entry.section;
+						offset = 0;
+					}
+
+					write_number(output, entry.section);
+					write_number(output, entry.offset - offset);
+					output.push_back(static_cast<byte>((static_cast<byte>(entry.kind) << 1) | static_cast<byte>(entry.target)));
+					write_number(output, entry.index);
+
+					// Zigzag, so small negative addends stay short
+					write_number(output, (static_cast<std::uint32_t>(entry.addend) << 1) ^ static_cast<std::uint32_t>(entry.addend >> 31));
+
+					offset = entry.offset;
+				}
+			}
+
+			void load(const byte * begin, const byte * end)
+			{
+				this->clear();
+
+				reader input { begin, end };
+
+				for(const byte value : object_file_signature)
+					if(input.read_byte() != value)
+						throw object_format_exception("not an object file");
+
+				if(input.read_byte() != object_file_version)
+					throw object_format_exception("unsupported object file version");
+
+				this->sections.resize(input.read_count());
+
+				for(auto & section : this->sections)
+				{
+					section.name = input.read_string();
+
+					const std::size_t size = input.read_count();
+					const byte * bytes = input.read_bytes(size);
+					section.bytes.assign(bytes, bytes + size);
+				}
+
+				this->symbols.resize(input.read_count());
+
+				for(auto & symbol : this->symbols)
+				{
+					symbol.name = input.read_string();
+
+					const byte binding = input.read_byte();
+
+					if(binding > static_cast<byte>(symbol_binding::imported))
+						throw object_format_exception("invalid symbol binding");
+
+					symbol.binding = static_cast<symbol_binding>(binding);
+
+					const std::uint32_t section = input.read_number();
+
+					if(section > this->sections.size())
+						throw object_format_exception("symbol refers to a missing section");
+
+					symbol.section = (section == 0) ? object_symbol::absolute : (section - 1);
+					symbol.value = input.read_number();
+				}
+
+				this->relocations.resize(input.read_count());
+
+				std::uint32_t previous_section = 0;
+				std::uint32_t offset = 0;
+
+				for(auto & entry : this->relocations)
+				{
+					entry.section = input.read_number();
+
+					if(entry.section >= this->sections.size() || entry.section < previous_section)
+						throw object_format_exception("relocation refers to a missing section");
+
+					if(entry.section != previous_section)
+					{
+						previous_section = entry.section;
+						offset = 0;
+					}
+
+					const std::uint32_t distance = input.read_number();
+
+					if(distance > (this->sections[entry.section].bytes.size() - offset))
+						throw object_format_exception("relocation lies outside its section");
+
+					offset += distance;
+					entry.offset = offset;
+
+					if((this->sections[entry.section].bytes.size() - offset) < 2)
+						throw object_format_exception("relocation lies outside its section");
+
+					const byte flags = input.read_byte();
+
+					if(flags > 3)
+						throw object_format_exception("invalid relocation kind");
+
+					entry.kind = static_cast<relocation_kind>(flags >> 1);
+					entry.target = static_cast<relocation_target>(flags & 1);
+					entry.index = input.read_number();
+
+					const std::size_t limit = (entry.target == relocation_target::section) ? this->sections.size() : this->symbols.size();
+
+					if(entry.index >= limit)
+						throw object_format_exception("relocation refers to a missing target");
+
+					const std::uint32_t addend = input.read_number();
+					entry.addend = static_cast<std::int32_t>((addend >> 1) ^ (0u - (addend & 1)));
+				}
+
+				if(!input.is_at_end())
+					throw object_format_exception("unexpected data at end of object file");
+			}
+
+		private:
+			// Unsigned LEB128
+			static void write_number(std::vector<byte> & output, std::size_t value)
+			{
+				while(value >= 0x80)
+				{
+					output.push_back(static_cast<byte>((value & 0x7F) | 0x80));
+					value >>= 7;
+				}
+
+				output.push_back(static_cast<byte>(value));
+			}
+
+			static void write_string(std::vector<byte> & output, const std::string & value)
+			{
+				write_number(output, value.size());
+				output.insert(output.end(), value.begin(), value.end());
+			}
+
+			struct reader
+			{
+				const byte * current;
+				const byte * end;
+
+				bool is_at_end() const
+				{
+					return (this->current == this->end);
+				}
+
+				byte read_byte()
+				{
+					if(this->current == this->end)
+						throw object_format_exception("object file is truncated");
+
+					return *this->current++;
+				}
+
+				const byte * read_bytes(std::size_t count)
+				{
+					if(static_cast<std::size_t>(this->end - this->current) < count)
+						throw object_format_exception("object file is truncated");
+
+					const byte * result = this->current;
+					this->current += count;
+					return result;
+				}
+
+				std::uint32_t read_number()
+				{
+					std::uint32_t result = 0;
+
+					for(unsigned shift = 0; shift < 35; shift += 7)
+					{
+						const byte value = this->read_byte();
+						result |= (static_cast<std::uint32_t>(value & 0x7F) << shift);
+
+						if((value & 0x80) == 0)
+							return result;
+					}
+
+					throw object_format_exception("number is too long");
+				}
+
+				// Counts are bounded by the bytes left, so a corrupt count cannot force a huge allocation
+				std::size_t read_count()
+				{
+					const std::size_t count = this->read_number();
+
+					if(count > static_cast<std::size_t>(this->end - this->current))
+						throw object_format_exception("object file is truncated");
+
+					return count;
+				}
+
+				std::string read_string()
+				{
+					const std::size_t length = this->read_count();
+					const byte * text = this->read_bytes(length);
+					return std::string(reinterpret_cast<const char *>(text), length);
+				}
+			};
+		};
+	}
+}
\ No newline at end of file
@@ -0,0 +1,159 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <vector>
+
+namespace chip8
+{
+	namespace assembler
+	{
+		enum class symbol_kind : std::uint8_t
+		{
+			undefined,
+			label,
+			constant,
+		};
+
+		struct symbol
+		{
+			const char * name;
+			std::size_t length;
+			std::uint32_t hash;
+			std::uint32_t value;
+			symbol_kind kind;
+			std::size_t line;
+
+			// The section a label lies in, when assembling an object
+			std::uint32_t section;
+
+			bool is_defined() const
+			{
+				return (this->kind != symbol_kind::undefined);
+			}
+		};
+
+		// Symbols live in insertion order, so their indices stay valid for fixups,
+		// while the slots form an open-addressed, linearly probed index over them
+		class symbol_table
+		{
+		public:
+			using size_type = std::size_t;
+			using index_type = std::uint32_t;
+
+		public:
+			static constexpr size_type initial_capacity = 256;
+
+		private:
+			static constexpr index_type empty_slot = 0;
+
+		private:
+			std::vector<symbol> symbols;
+			std::vector<index_type> slots = std::vector<index_type>(initial_capacity, index_type(empty_slot));
+
+		public:
+			size_type size() const
+			{
+				return this->symbols.size();
+			}
+
+			symbol & operator[](index_type index)
+			{
+				return this->symbols[index];
+			}
+
+			const symbol & operator[](index_type index) const
+			{
+				return this->symbols[index];
+			}
+
+			const symbol * find(const char * name, std::size_t length) const
+			{
+				const std::uint32_t hash = get_hash(name, length);
+				const size_type slot = this->find_slot(name, length, hash);
+
+				return (this->slots[slot] != empty_slot) ? &this->symbols[this->slots[slot] - 1] : nullptr;
+			}
+
+			// Returns the index of the named symbol, adding it as undefined if it is new
+			index_type intern(const char * name, std::size_t length, std::size_t line)
+			{
+				const std::uint32_t hash = get_hash(name, length);
+				size_type slot = this->find_slot(name, length, hash);
+
+				if(this->slots[slot] != empty_slot)
+					return (this->slots[slot] - 1);
+
+				// Kept at most half full so probe sequences stay short
+				if(((this->symbols.size() + 1) * 2) > this->slots.size())
+				{
+					this->grow();
+					slot = this->find_slot(name, length, hash);
+				}
+
+				const auto index = static_cast<index_type>(this->symbols.size());
+				this->symbols.push_back(symbol { name, length, hash, 0, symbol_kind::undefined, line, 0 });
+				this->slots[slot] = (index + 1);
+
+				return index;
+			}
+
+			void clear()
+			{
+				this->symbols.clear();
+				this->slots.assign(initial_capacity, index_type(empty_slot));
+			}
+
+		private:
+			// FNV-1a
+			static std::uint32_t get_hash(const char * name, std::size_t length)
+			{
+				std::uint32_t hash = 0x811C9DC5u;
+
+				for(std::size_t index = 0; index < length; ++index)
+				{
+					hash ^= static_cast<unsigned char>(name[index]);
+					hash *= 0x01000193u;
+				}
+
+				return hash;
+			}
+
+			size_type find_slot(const char * name, std::size_t length, std::uint32_t hash) const
+			{
+				const size_type mask = (this->slots.size() - 1);
+
+				for(size_type slot = (hash & mask);; slot = ((slot + 1) & mask))
+				{
+					const index_type entry = this->slots[slot];
+
+					if(entry == empty_slot)
+						return slot;
+
+					const symbol & candidate = this->symbols[entry - 1];
+
+					if(candidate.hash == hash && candidate.length == length && std::memcmp(candidate.name, name, length) == 0)
+						return slot;
+				}
+			}
+
+			void grow()
+			{
+				this->slots.assign(this->slots.size() * 2, index_type(empty_slot));
+
+				const size_type mask = (this->slots.size() - 1);
+
+				for(size_type index = 0; index < this->symbols.size(); ++index)
+				{
+					size_type slot = (this->symbols[index].hash & mask);
+
+					while(this->slots[slot] != empty_slot)
+						slot = ((slot + 1) & mask);
+
+					this->slots[slot] = static_cast<index_type>(index + 1);
+				}
+			}
+		};
+	}
+}
\ No newline at end of file